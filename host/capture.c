@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file capture.c
+ *
+ * Implements the reading and writing of captures declared in capture.h
+ *
+ * @see capture.h
+ */
+
+#include <string.h>
+
+#include "capture.h"
+
+/**
+ * Writes the header of a capture
+ *
+ * @param file File to write the header to
+ *
+ * @return Zero on success, -1 otherwise
+ */
+int capture_write_header(FILE* file)
+{
+
+    if (fwrite(CAPTURE_MAGIC, 1, sizeof(CAPTURE_MAGIC) - 1, file)
+        != sizeof(CAPTURE_MAGIC) - 1) {
+
+        return -1;
+
+    }
+
+    return 0;
+
+}
+
+/**
+ * Reads and checks the header of a capture
+ *
+ * @param file File to read the header from
+ *
+ * @return Zero on success, -1 if the file isn't a capture
+ */
+int capture_read_header(FILE* file)
+{
+
+    char magic[sizeof(CAPTURE_MAGIC) - 1];
+
+    if (fread(magic, 1, sizeof(magic), file) != sizeof(magic)
+        || memcmp(magic, CAPTURE_MAGIC, sizeof(magic))) {
+
+        return -1;
+
+    }
+
+    return 0;
+
+}
+
+/**
+ * Writes a single record to a capture
+ *
+ * @param file File to write the record to
+ * @param record Record to write
+ *
+ * @return Zero on success, -1 otherwise
+ */
+int capture_write(FILE* file, const capture_record_t* record)
+{
+
+    uint8_t buffer[CAPTURE_RECORD_SIZE];
+
+    for (int i = 0; i < 8; i++) {
+
+        buffer[i] = record->time >> (8 * i);
+
+    }
+
+    buffer[8] = record->segment;
+    buffer[9] = record->byte;
+
+    if (fwrite(buffer, 1, sizeof(buffer), file) != sizeof(buffer)) {
+
+        return -1;
+
+    }
+
+    return 0;
+
+}
+
+/**
+ * Reads a single record from a capture
+ *
+ * @param file File to read the record from
+ * @param record Pointer the record is stored at
+ *
+ * @return One if a record has been read, zero at the end of the capture, -1
+ * if the capture is truncated or can't be read
+ */
+int capture_read(FILE* file, capture_record_t* record)
+{
+
+    uint8_t buffer[CAPTURE_RECORD_SIZE];
+    size_t size = fread(buffer, 1, sizeof(buffer), file);
+
+    if (size != sizeof(buffer)) {
+
+        return (size == 0 && !ferror(file)) ? 0 : -1;
+
+    }
+
+    record->time = 0;
+
+    for (int i = 0; i < 8; i++) {
+
+        record->time |= (uint64_t)buffer[i] << (8 * i);
+
+    }
+
+    record->segment = buffer[8];
+    record->byte = buffer[9];
+
+    return 1;
+
+}
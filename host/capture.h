@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file capture.h
+ *
+ * Captures of the traffic on the bus
+ *
+ * A capture holds the bytes transferred on one or more bus segments along
+ * with the time they have been transferred at, so that it can be replayed
+ * deterministically later on. It starts with {@link #CAPTURE_MAGIC},
+ * followed by records of the following format:
+ *
+ * \code
+ *  +---------------------------------+---------+------+
+ *  | TIME (8 bytes, little endian)   | SEGMENT | BYTE |
+ *  +---------------------------------+---------+------+
+ * \endcode
+ *
+ * `TIME` is the time the byte has been completely transferred at in
+ * microseconds since the start of the capture, and `SEGMENT` is the bus
+ * segment (i.e. the serial port of the master) it has been transferred on.
+ * Records of the same segment are ordered by time.
+ *
+ * @see capture.c
+ */
+
+#ifndef _LTT_HOST_CAPTURE_H_
+#define _LTT_HOST_CAPTURE_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+
+/**
+ * @brief Bytes at the start of each capture
+ */
+#define CAPTURE_MAGIC "LTC1"
+
+/**
+ * @brief Size of a single record in bytes
+ */
+#define CAPTURE_RECORD_SIZE 10
+
+/**
+ * A single byte transferred on the bus
+ */
+typedef struct {
+
+    /**
+     * @brief Time the byte has been transferred at in microseconds
+     */
+    uint64_t time;
+
+    /**
+     * @brief Bus segment the byte has been transferred on
+     */
+    uint8_t segment;
+
+    /**
+     * @brief Byte transferred
+     */
+    uint8_t byte;
+
+} capture_record_t;
+
+int capture_write_header(FILE* file);
+int capture_read_header(FILE* file);
+
+int capture_write(FILE* file, const capture_record_t* record);
+int capture_read(FILE* file, capture_record_t* record);
+
+#endif /* _LTT_HOST_CAPTURE_H_ */
@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file drive.c
+ *
+ * Tool driving a test pattern onto multiple bus segments
+ *
+ * \code
+ *  drive [-p PERIOD] [-n PIXELS] [-f FRAMES] [-d DITHER] DEVICE...
+ *  drive [-p PERIOD] [-n PIXELS] [-f FRAMES] [-d DITHER] -t SEGMENTS
+ * \endcode
+ *
+ * Each device is the serial port of a single segment with the given amount
+ * of pixels (16 by default). A rainbow moving across the pixels is rendered
+ * and passed through the {@link pipeline.h pipeline} with a frame period of
+ * `PERIOD` microseconds (20000 by default), for the given amount of frames
+ * (forever by default). `DITHER` selects the
+ * {@link encoder_set_dither() dithering} (none by default). Statistics are
+ * written to the standard error output at the end.
+ *
+ * `-t` creates pseudo terminals standing in for the serial ports instead,
+ * which are drained by the tool itself. As the bytes are paced to the speed
+ * of the bus anyway, this allows to find out how the frame rate scales with
+ * the amount of segments without any hardware, i.e. the shortest period
+ * that doesn't cause late frames.
+ *
+ * It can be built with:
+ *
+ * \code
+ *  cc -std=gnu99 -pthread -I../src -o drive drive.c driver.c encoder.c \
+ *      frame.c layout.c pipeline.c pty.c ../src/crc.c ../src/fec.c
+ * \endcode
+ *
+ * @see driver.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "driver.h"
+#include "encoder.h"
+#include "layout.h"
+#include "pipeline.h"
+#include "pty.h"
+#include "protocol.h"
+
+/**
+ * @brief Maximum amount of pixels within a single segment
+ */
+#define DRIVE_PIXELS_MAX (PROTOCOL_ADDRESS_BROADCAST - 1)
+
+/**
+ * Test pattern being rendered
+ */
+typedef struct {
+
+    /**
+     * @brief Layout of the pixels
+     */
+    const layout_t* layout;
+
+    /**
+     * @brief Amount of frames to render, zero for an infinite amount
+     */
+    unsigned long frames;
+
+} drive_pattern_t;
+
+/**
+ * Converts a hue into a fully saturated color
+ *
+ * @param hue Hue, with 256 steps per sixth of the color wheel
+ * @param color Pointer the color is stored at
+ */
+static void drive_hue(unsigned int hue, uint8_t* color)
+{
+
+    uint8_t rise = hue & 0xFF;
+    uint8_t fall = UINT8_MAX - rise;
+
+    switch ((hue >> 8) % 6) {
+
+        case 0: color[0] = 255; color[1] = rise; color[2] = 0; break;
+        case 1: color[0] = fall; color[1] = 255; color[2] = 0; break;
+        case 2: color[0] = 0; color[1] = 255; color[2] = rise; break;
+        case 3: color[0] = 0; color[1] = fall; color[2] = 255; break;
+        case 4: color[0] = rise; color[1] = 0; color[2] = 255; break;
+        default: color[0] = 255; color[1] = 0; color[2] = fall; break;
+
+    }
+
+}
+
+/**
+ * Renders a single frame of the test pattern
+ *
+ * @param context Test pattern to render
+ * @param frame Number of the frame
+ * @param linear Buffer the frame is rendered into
+ *
+ * @return Zero on success, non-zero value after the last frame
+ */
+static int drive_render(void* context, unsigned long frame, uint16_t* linear)
+{
+
+    const drive_pattern_t* pattern = context;
+    size_t pixels = (size_t)pattern->layout->width * pattern->layout->height;
+
+    if (pattern->frames && frame >= pattern->frames) {
+
+        return 1;
+
+    }
+
+    for (size_t i = 0; i < pixels; i++) {
+
+        uint8_t color[3];
+
+        drive_hue((frame * 16 + i * 64) % 1536, color);
+
+        // Square the steps, which is roughly how they are perceived
+        for (int j = 0; j < 3; j++) {
+
+            linear[i * 3 + j] = (uint32_t)color[j] * color[j] * UINT16_MAX
+                / (UINT8_MAX * UINT8_MAX);
+
+        }
+
+    }
+
+    return 0;
+
+}
+
+int main(int argc, char* argv[])
+{
+
+    unsigned long period = 20000;
+    unsigned long pixels = 16;
+    unsigned long frames = 0;
+    unsigned long ptys = 0;
+    int dither = ENCODER_DITHER_NONE;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:n:f:t:d:")) != -1) {
+
+        switch (opt) {
+
+            case 'p':
+                period = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'n':
+                pixels = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'f':
+                frames = strtoul(optarg, NULL, 0);
+                break;
+
+            case 't':
+                ptys = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'd':
+                dither = strtoul(optarg, NULL, 0);
+                break;
+
+            default:
+                goto usage;
+
+        }
+
+    }
+
+    const char* devices[DRIVER_SEGMENTS_MAX];
+    int segments = ptys ? (int)ptys : argc - optind;
+
+    if (!period || pixels < 1 || pixels > DRIVE_PIXELS_MAX || segments < 1
+        || segments > DRIVER_SEGMENTS_MAX || (ptys && optind != argc)) {
+
+        goto usage;
+
+    }
+
+    for (int i = 0; i < segments; i++) {
+
+        devices[i] = ptys ? pty_open() : argv[optind + i];
+
+        if (!devices[i]) {
+
+            perror("pty");
+
+            return EXIT_FAILURE;
+
+        }
+
+    }
+
+    layout_t layout;
+
+    if (layout_init(&layout, pixels, segments, segments)) {
+
+        perror("layout");
+
+        return EXIT_FAILURE;
+
+    }
+
+    // The frame clock starts with the driver, so it is opened last
+    encoder_t* encoder = encoder_create(&layout);
+
+    if (encoder) {
+
+        encoder_set_dither(encoder, dither);
+
+    }
+
+    driver_t* driver = encoder ? driver_open(devices, segments, period, pixels)
+        : NULL;
+
+    if (!driver || !encoder) {
+
+        perror("driver");
+
+        return EXIT_FAILURE;
+
+    }
+
+    drive_pattern_t pattern = {
+
+        .layout = &layout,
+        .frames = frames,
+
+    };
+
+    pipeline_stats_t pipeline_stats;
+
+    if (pipeline_run(&layout, encoder, driver, drive_render, &pattern,
+        &pipeline_stats)) {
+
+        perror("pipeline");
+
+        return EXIT_FAILURE;
+
+    }
+
+    driver_stats_t stats;
+    driver_get_stats(driver, &stats);
+    driver_close(driver);
+    encoder_destroy(encoder);
+    layout_free(&layout);
+
+    for (int i = 0; ptys && i < segments; i++) {
+
+        free((char*)devices[i]);
+
+    }
+
+    fprintf(stderr, "%lu frames, %lu late, %llu bytes, %lu errors\n",
+        stats.frames, stats.late, stats.bytes, stats.errors);
+    fprintf(stderr, "%.1f us rendering, %.1f us encoding per frame\n",
+        (double)pipeline_stats.render / pipeline_stats.frames,
+        (double)pipeline_stats.encode / pipeline_stats.frames);
+
+    return (stats.errors) ? EXIT_FAILURE : EXIT_SUCCESS;
+
+usage:
+
+    fprintf(stderr, "usage: %s [-p PERIOD] [-n PIXELS] [-f FRAMES] "
+        "[-d DITHER] {DEVICE... | -t SEGMENTS}\n", argv[0]);
+
+    return EXIT_FAILURE;
+
+}
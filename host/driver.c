@@ -0,0 +1,678 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file driver.c
+ *
+ * Implements the driver for multiple bus segments declared in driver.h
+ *
+ * Each segment has a writer thread of its own, which waits for the frame
+ * clock to start a new frame. The bytes of a frame are written in chunks
+ * paced to the speed of the bus, so that the time each byte leaves the
+ * master is known. This allows to send the time within
+ * {@link PROTOCOL_COMMAND_SYNC_CLOCK} frames precisely, and makes pseudo
+ * terminals standing in for serial ports behave like the real bus.
+ *
+ * Serial ports are configured using the `termios2` interface of Linux, as
+ * the baud rate of the bus isn't one of the standard rates. Other files
+ * (e.g. pipes) are written to as they are.
+ *
+ * @see driver.h
+ */
+
+#include <asm/termbits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bus.h"
+#include "clock.h"
+#include "driver.h"
+#include "frame.h"
+#include "protocol.h"
+
+/**
+ * @brief Amount of bytes written at once
+ */
+#define DRIVER_CHUNK 32
+
+/**
+ * A single segment and its writer thread
+ */
+typedef struct {
+
+    /**
+     * @brief Driver the segment belongs to
+     */
+    struct driver* driver;
+
+    /**
+     * @brief File descriptor of the serial port
+     */
+    int fd;
+
+    /**
+     * @brief Writer thread of the segment
+     */
+    pthread_t thread;
+
+    /**
+     * @brief Bytes to transmit within the current frame
+     */
+    driver_buffer_t buffer;
+
+} driver_segment_t;
+
+struct driver {
+
+    /**
+     * @brief Segments being driven
+     */
+    driver_segment_t segments[DRIVER_SEGMENTS_MAX];
+
+    /**
+     * @brief Amount of segments being driven
+     */
+    int count;
+
+    /**
+     * @brief Mutex protecting all of the following members
+     */
+    pthread_mutex_t mutex;
+
+    /**
+     * @brief Signalled when a new frame is to be transmitted
+     */
+    pthread_cond_t start;
+
+    /**
+     * @brief Signalled when all of the writers are done
+     */
+    pthread_cond_t done;
+
+    /**
+     * @brief Incremented for each frame to be transmitted
+     */
+    unsigned long generation;
+
+    /**
+     * @brief Amount of writers still transmitting the current frame
+     */
+    int busy;
+
+    /**
+     * @brief Whether the writers are to stop
+     */
+    int stop;
+
+    /**
+     * @brief Whether the current frame is preceded by a synchronization
+     */
+    int sync;
+
+    /**
+     * @brief Time the clock of the master has started at
+     */
+    uint64_t epoch;
+
+    /**
+     * @brief Time the current frame has been started at
+     */
+    uint64_t tick;
+
+    /**
+     * @brief Periods of the frame clock skipped by late frames
+     */
+    unsigned long skipped;
+
+    /**
+     * @brief Time the clock has been synchronized the last time
+     */
+    uint64_t synced;
+
+    /**
+     * @brief Period of the frame clock
+     */
+    uint64_t period;
+
+    /**
+     * @brief Amount of telemetry slots announced by the synchronization
+     */
+    uint8_t slots;
+
+    /**
+     * @brief Time the frames need to reach the end of the segments
+     */
+    uint64_t margin;
+
+    /**
+     * @brief Statistics
+     */
+    driver_stats_t stats;
+
+};
+
+/**
+ * Returns the current time
+ *
+ * @return Time in microseconds
+ */
+static uint64_t driver_now()
+{
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+}
+
+/**
+ * Sleeps until the given time
+ *
+ * @param time Time in microseconds
+ */
+static void driver_sleep(uint64_t time)
+{
+
+    struct timespec ts = {
+
+        .tv_sec = time / 1000000,
+        .tv_nsec = (time % 1000000) * 1000,
+
+    };
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)
+        == EINTR);
+
+}
+
+/**
+ * Converts a time into ticks of the clock of the master
+ *
+ * @param driver Driver the clock belongs to
+ * @param time Time in microseconds, rounded up to the next tick
+ *
+ * @return Time in ticks
+ */
+static uint16_t driver_ticks(struct driver* driver, uint64_t time)
+{
+
+    return (time - driver->epoch + CLOCK_TICK - 1) / CLOCK_TICK;
+
+}
+
+/**
+ * Configures a serial port for the bus
+ *
+ * @param fd File descriptor of the serial port
+ *
+ * @return Zero on success (or if it isn't a serial port), -1 otherwise
+ */
+static int driver_configure(int fd)
+{
+
+    struct termios2 tio;
+
+    if (ioctl(fd, TCGETS2, &tio)) {
+
+        return (errno == ENOTTY) ? 0 : -1;
+
+    }
+
+    tio.c_cflag &= ~(CBAUD | CSIZE | PARENB | CSTOPB | CRTSCTS);
+    tio.c_cflag |= BOTHER | CS8 | CLOCAL | CREAD;
+    tio.c_iflag = 0;
+    tio.c_oflag = 0;
+    tio.c_lflag = 0;
+    tio.c_ispeed = BUS_BAUD;
+    tio.c_ospeed = BUS_BAUD;
+
+    return ioctl(fd, TCSETS2, &tio);
+
+}
+
+/**
+ * Writes bytes to a segment paced to the speed of the bus
+ *
+ * @param segment Segment to write to
+ * @param data Bytes to write
+ * @param size Amount of bytes to write
+ * @param time Time the first byte is to be written at, advanced by the time
+ * the bytes take on the bus
+ *
+ * @return Zero on success, -1 otherwise
+ */
+static int driver_write(driver_segment_t* segment, const uint8_t* data,
+    size_t size, uint64_t* time)
+{
+
+    while (size) {
+
+        size_t chunk = (size < DRIVER_CHUNK) ? size : DRIVER_CHUNK;
+
+        driver_sleep(*time);
+
+        for (size_t written = 0; written < chunk; ) {
+
+            ssize_t result = write(segment->fd, data + written,
+                chunk - written);
+
+            if (result < 0 && errno != EINTR) {
+
+                return -1;
+
+            }
+
+            if (result > 0) {
+
+                written += result;
+
+            }
+
+        }
+
+        data += chunk;
+        size -= chunk;
+        *time += chunk * BUS_BYTE_TIME;
+
+    }
+
+    return 0;
+
+}
+
+/**
+ * Synchronizes the clocks of the pixels of a segment
+ *
+ * The frame is delayed, so that it is finished exactly at the beginning of a
+ * tick, which is the time it carries. It announces a telemetry slot for each
+ * pixel of the longest segment, so that every pixel keeps its slot.
+ *
+ * @param segment Segment to synchronize
+ * @param time Earliest time the frame can be written at, advanced by the
+ * time the frame takes on the bus
+ *
+ * @return Zero on success, -1 otherwise
+ */
+static int driver_sync(driver_segment_t* segment, uint64_t* time)
+{
+
+    struct driver* driver = segment->driver;
+    uint8_t frame[FRAME_SIZE_MAX];
+    uint8_t payload[4] = {0, 0, 0, driver->slots};
+
+    size_t size = frame_encode(frame, PROTOCOL_COMMAND_SYNC_CLOCK,
+        PROTOCOL_ADDRESS_BROADCAST, payload, sizeof(payload), 1);
+
+    uint16_t ticks = driver_ticks(driver, *time + size * BUS_BYTE_TIME);
+    uint64_t end = driver->epoch + (uint64_t)ticks * CLOCK_TICK;
+
+    // Account for ticks the clock wrapped around
+    while (end < *time + size * BUS_BYTE_TIME) {
+
+        end += (uint64_t)CLOCK_TICK << 16;
+
+    }
+
+    *time = end - size * BUS_BYTE_TIME;
+
+    payload[1] = ticks;
+    payload[2] = ticks >> 8;
+
+    size = frame_encode(frame, PROTOCOL_COMMAND_SYNC_CLOCK,
+        PROTOCOL_ADDRESS_BROADCAST, payload, sizeof(payload), 1);
+
+    return driver_write(segment, frame, size, time);
+
+}
+
+/**
+ * Transmits the frames of a single segment
+ *
+ * @param arg Segment to transmit the frames of
+ *
+ * @return NULL
+ */
+static void* driver_writer(void* arg)
+{
+
+    driver_segment_t* segment = arg;
+    struct driver* driver = segment->driver;
+    unsigned long generation = 0;
+
+    pthread_mutex_lock(&driver->mutex);
+
+    while (1) {
+
+        while (driver->generation == generation && !driver->stop) {
+
+            pthread_cond_wait(&driver->start, &driver->mutex);
+
+        }
+
+        if (driver->stop) {
+
+            break;
+
+        }
+
+        generation = driver->generation;
+
+        driver_buffer_t buffer = segment->buffer;
+        uint64_t time = driver->tick;
+        int sync = driver->sync;
+
+        pthread_mutex_unlock(&driver->mutex);
+
+        int result = (sync && driver_sync(segment, &time))
+            || driver_write(segment, buffer.data, buffer.size, &time);
+
+        pthread_mutex_lock(&driver->mutex);
+
+        if (result) {
+
+            driver->stats.errors++;
+
+        }
+
+        if (--driver->busy == 0) {
+
+            pthread_cond_signal(&driver->done);
+
+        }
+
+    }
+
+    pthread_mutex_unlock(&driver->mutex);
+
+    return NULL;
+
+}
+
+/**
+ * Opens the serial ports of all segments and starts the writer threads
+ *
+ * @param devices Paths of the serial ports, one for each segment
+ * @param segments Amount of segments
+ * @param period Period of the frame clock in microseconds
+ * @param pixels Maximum amount of pixels within a single segment
+ *
+ * @return Driver, or NULL on failure (with `errno` set accordingly)
+ */
+driver_t* driver_open(const char* const* devices, int segments,
+    unsigned long period, unsigned int pixels)
+{
+
+    if (segments < 1 || segments > DRIVER_SEGMENTS_MAX || !period) {
+
+        errno = EINVAL;
+
+        return NULL;
+
+    }
+
+    struct driver* driver = calloc(1, sizeof(*driver));
+
+    if (!driver) {
+
+        return NULL;
+
+    }
+
+    pthread_mutex_init(&driver->mutex, NULL);
+    pthread_cond_init(&driver->start, NULL);
+    pthread_cond_init(&driver->done, NULL);
+
+    driver->period = period;
+    driver->margin = (uint64_t)pixels * (BUS_HOP_DELAY + BUS_BYTE_TIME);
+    driver->slots = (pixels < UINT8_MAX) ? pixels : UINT8_MAX;
+    driver->epoch = driver_now();
+    driver->tick = driver->epoch;
+    driver->synced = driver->epoch - DRIVER_SYNC_INTERVAL;
+
+    for (int i = 0; i < segments; i++) {
+
+        driver_segment_t* segment = &driver->segments[i];
+
+        segment->driver = driver;
+        segment->fd = open(devices[i], O_WRONLY | O_NOCTTY);
+
+        if (segment->fd < 0 || driver_configure(segment->fd)
+            || pthread_create(&segment->thread, NULL, driver_writer,
+            segment)) {
+
+            int error = errno;
+
+            if (segment->fd >= 0) {
+
+                close(segment->fd);
+
+            }
+
+            driver_close(driver);
+            errno = error;
+
+            return NULL;
+
+        }
+
+        driver->count++;
+
+    }
+
+    return driver;
+
+}
+
+/**
+ * Waits for the writers to finish the current frame
+ *
+ * @note The mutex needs to be locked when calling this.
+ *
+ * @param driver Driver to wait for
+ */
+static void driver_wait(struct driver* driver)
+{
+
+    while (driver->busy) {
+
+        pthread_cond_wait(&driver->done, &driver->mutex);
+
+    }
+
+}
+
+/**
+ * Waits for the current frame to be transmitted and stops the driver
+ *
+ * @param driver Driver to stop
+ */
+void driver_close(driver_t* driver)
+{
+
+    pthread_mutex_lock(&driver->mutex);
+
+    driver_wait(driver);
+
+    driver->stop = 1;
+    pthread_cond_broadcast(&driver->start);
+    pthread_mutex_unlock(&driver->mutex);
+
+    for (int i = 0; i < driver->count; i++) {
+
+        pthread_join(driver->segments[i].thread, NULL);
+        close(driver->segments[i].fd);
+
+    }
+
+    pthread_cond_destroy(&driver->done);
+    pthread_cond_destroy(&driver->start);
+    pthread_mutex_destroy(&driver->mutex);
+
+    free(driver);
+
+}
+
+/**
+ * Returns the latch time of a frame
+ *
+ * Frame `n` is transmitted within period `n + 1` of the frame clock and
+ * presented at the end of it, plus the time it takes to reach the end of the
+ * segments. Periods skipped by late frames are added to that. As this only
+ * depends on the number of the frame otherwise, frames can be encoded ahead
+ * of time.
+ *
+ * @param driver Driver transmitting the frame
+ * @param frame Number of the frame, starting with zero
+ *
+ * @return Latch time of the frame in ticks of the clock of the pixels, at
+ * which its colors are to be presented
+ */
+uint16_t driver_latch(driver_t* driver, unsigned long frame)
+{
+
+    pthread_mutex_lock(&driver->mutex);
+    frame += driver->skipped;
+    pthread_mutex_unlock(&driver->mutex);
+
+    return driver_ticks(driver, driver->epoch
+        + (uint64_t)(frame + 2) * driver->period + driver->margin);
+
+}
+
+/**
+ * Waits for the next frame to begin
+ *
+ * This waits for the previous frame to be transmitted completely, and for
+ * the period of the frame clock the next frame is to be transmitted within.
+ * If the driver has fallen behind, the frame is counted as late and begins
+ * right away. The periods that have passed in the meantime are skipped, so
+ * that the latch times of the following frames don't trail behind by more
+ * than a period. Frames encoded before are presented as soon as they arrive.
+ *
+ * @param driver Driver to wait for
+ *
+ * @return Latch time of the frame, see driver_latch()
+ */
+uint16_t driver_begin(driver_t* driver)
+{
+
+    pthread_mutex_lock(&driver->mutex);
+
+    driver_wait(driver);
+
+    unsigned long frame = driver->stats.frames;
+    uint64_t tick = driver->epoch
+        + (uint64_t)(frame + driver->skipped + 1) * driver->period;
+    uint64_t now = driver_now();
+
+    if (tick < now) {
+
+        unsigned long skip = (now - tick) / driver->period;
+
+        driver->stats.late++;
+        driver->skipped += skip;
+        tick = now;
+
+    }
+
+    driver->tick = tick;
+
+    pthread_mutex_unlock(&driver->mutex);
+
+    driver_sleep(tick);
+
+    return driver_latch(driver, frame);
+
+}
+
+/**
+ * Waits for the current frame to be transmitted completely
+ *
+ * Afterwards the buffers passed to driver_transmit() can be released.
+ *
+ * @param driver Driver to wait for
+ */
+void driver_flush(driver_t* driver)
+{
+
+    pthread_mutex_lock(&driver->mutex);
+    driver_wait(driver);
+    pthread_mutex_unlock(&driver->mutex);
+
+}
+
+/**
+ * Starts transmitting a frame on all segments
+ *
+ * This returns right away, the buffers need to stay valid until the next
+ * call of driver_begin() or driver_flush().
+ *
+ * @param driver Driver to transmit the frame with
+ * @param buffers Bytes to be transmitted, one buffer for each segment
+ */
+void driver_transmit(driver_t* driver, const driver_buffer_t* buffers)
+{
+
+    pthread_mutex_lock(&driver->mutex);
+
+    driver->sync = (driver->tick - driver->synced >= DRIVER_SYNC_INTERVAL);
+
+    if (driver->sync) {
+
+        driver->synced = driver->tick;
+
+    }
+
+    for (int i = 0; i < driver->count; i++) {
+
+        driver->segments[i].buffer = buffers[i];
+        driver->stats.bytes += buffers[i].size;
+
+    }
+
+    driver->stats.frames++;
+    driver->generation++;
+    driver->busy = driver->count;
+
+    pthread_cond_broadcast(&driver->start);
+    pthread_mutex_unlock(&driver->mutex);
+
+}
+
+/**
+ * Returns the statistics of a driver
+ *
+ * @param driver Driver to return the statistics of
+ * @param stats Pointer the statistics are copied to
+ */
+void driver_get_stats(driver_t* driver, driver_stats_t* stats)
+{
+
+    pthread_mutex_lock(&driver->mutex);
+    *stats = driver->stats;
+    pthread_mutex_unlock(&driver->mutex);
+
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file driver.h
+ *
+ * Driver for multiple bus segments on the host
+ *
+ * The pixels of a table can be split up into multiple segments, each of
+ * which is a chain of its own connected to a serial port of the master. As
+ * each segment only carries the frames of its own pixels, the frame rate
+ * scales with the amount of segments.
+ *
+ * The segments are driven by writer threads in parallel, which are started
+ * at the same time by a shared frame clock. All segments are regularly
+ * {@link PROTOCOL_COMMAND_SYNC_CLOCK synchronized} to the clock of the
+ * master, so that colors {@link PROTOCOL_COMMAND_QUEUE_COLOR queued} for the
+ * {@link driver_begin() latch time} of a frame are presented by all pixels
+ * at the same time, no matter which segment they are connected to or when
+ * exactly their frame has been transmitted.
+ *
+ * Usage:
+ *
+ * \code
+ *  driver_t* driver = driver_open(devices, segments, period, pixels);
+ *
+ *  while (...) {
+ *
+ *      uint16_t latch = driver_begin(driver);
+ *
+ *      // Encode frames queueing the colors for the latch time
+ *
+ *      driver_transmit(driver, buffers);
+ *
+ *  }
+ *
+ *  driver_close(driver);
+ * \endcode
+ *
+ * @see driver.c
+ */
+
+#ifndef _LTT_HOST_DRIVER_H_
+#define _LTT_HOST_DRIVER_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+/**
+ * @brief Maximum amount of segments driven at once
+ */
+#define DRIVER_SEGMENTS_MAX 16
+
+/**
+ * @brief Interval between synchronizations of the clock in microseconds
+ */
+#define DRIVER_SYNC_INTERVAL 1000000UL
+
+/**
+ * Bytes to be transmitted on a single segment within a frame
+ */
+typedef struct {
+
+    /**
+     * @brief Bytes to transmit
+     */
+    const uint8_t* data;
+
+    /**
+     * @brief Amount of bytes to transmit
+     */
+    size_t size;
+
+} driver_buffer_t;
+
+/**
+ * Statistics of a driver
+ */
+typedef struct {
+
+    /**
+     * @brief Frames transmitted
+     */
+    unsigned long frames;
+
+    /**
+     * @brief Frames that couldn't be transmitted within their period
+     */
+    unsigned long late;
+
+    /**
+     * @brief Bytes transmitted on all segments
+     */
+    unsigned long long bytes;
+
+    /**
+     * @brief Writes to any of the segments that failed
+     */
+    unsigned long errors;
+
+} driver_stats_t;
+
+/**
+ * Driver for multiple bus segments
+ */
+typedef struct driver driver_t;
+
+driver_t* driver_open(const char* const* devices, int segments,
+    unsigned long period, unsigned int pixels);
+void driver_close(driver_t* driver);
+
+uint16_t driver_latch(driver_t* driver, unsigned long frame);
+uint16_t driver_begin(driver_t* driver);
+void driver_transmit(driver_t* driver, const driver_buffer_t* buffers);
+void driver_flush(driver_t* driver);
+
+void driver_get_stats(driver_t* driver, driver_stats_t* stats);
+
+#endif /* _LTT_HOST_DRIVER_H_ */
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file encode.c
+ *
+ * Tool encoding a single frame on the host
+ *
+ * \code
+ *  encode [-f] [-x] COMMAND ADDRESS [PAYLOAD...]
+ * \endcode
+ *
+ * All of the arguments are numbers as accepted by strtoul(), e.g. `0x01`.
+ * The encoded frame is written to the standard output, which can be
+ * redirected to the serial port the master is connected to. `-f` enables
+ * forward error correction, `-x` writes the frame as hexadecimal text
+ * instead.
+ *
+ * It can be built with:
+ *
+ * \code
+ *  cc -std=gnu99 -I../src -o encode encode.c frame.c ../src/crc.c ../src/fec.c
+ * \endcode
+ *
+ * @see frame.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "frame.h"
+
+/**
+ * Parses a single numeric argument, which needs to fit into a byte
+ *
+ * @param arg Argument to parse
+ * @param byte Pointer the parsed value is stored at
+ *
+ * @return Zero on success, -1 otherwise
+ */
+static int parse_byte(const char* arg, uint8_t* byte)
+{
+
+    char* end;
+    unsigned long value = strtoul(arg, &end, 0);
+
+    if (*arg == '\0' || *end != '\0' || value > UINT8_MAX) {
+
+        return -1;
+
+    }
+
+    *byte = value;
+
+    return 0;
+
+}
+
+int main(int argc, char* argv[])
+{
+
+    int fec = 0;
+    int hex = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "fx")) != -1) {
+
+        switch (opt) {
+
+            case 'f':
+                fec = 1;
+                break;
+
+            case 'x':
+                hex = 1;
+                break;
+
+            default:
+                goto usage;
+
+        }
+
+    }
+
+    uint8_t command;
+    uint8_t address;
+    uint8_t payload[FRAME_PAYLOAD_MAX];
+    int length = argc - optind - 2;
+
+    if (length < 0 || length > FRAME_PAYLOAD_MAX
+        || parse_byte(argv[optind], &command)
+        || parse_byte(argv[optind + 1], &address)) {
+
+        goto usage;
+
+    }
+
+    for (int i = 0; i < length; i++) {
+
+        if (parse_byte(argv[optind + 2 + i], &payload[i])) {
+
+            goto usage;
+
+        }
+
+    }
+
+    uint8_t buffer[FRAME_SIZE_MAX];
+    size_t size = frame_encode(buffer, command, address, payload, length, fec);
+
+    if (hex) {
+
+        for (size_t i = 0; i < size; i++) {
+
+            printf("%02x%c", buffer[i], (i + 1 == size) ? '\n' : ' ');
+
+        }
+
+    } else {
+
+        fwrite(buffer, 1, size, stdout);
+
+    }
+
+    return EXIT_SUCCESS;
+
+usage:
+
+    fprintf(stderr, "usage: %s [-f] [-x] COMMAND ADDRESS [PAYLOAD...]\n",
+        argv[0]);
+
+    return EXIT_FAILURE;
+
+}
@@ -0,0 +1,774 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file encoder.c
+ *
+ * Implements the encoder declared in encoder.h
+ *
+ * The quantization uses an inverse of the PWM table covering each possible
+ * linear value, so it comes down to a single lookup per channel.
+ *
+ * Optionally the quantization is dithered, still within linear light:
+ * Ordered dithering compares the position of each value in between the two
+ * closest steps with a threshold from a Bayer matrix, so the result only
+ * depends on the value and the position of the pixel. Error diffusion
+ * distributes the error of each pixel to the pixels not quantized yet, as
+ * proposed by Floyd and Steinberg, scanning the rows in a serpentine. Error
+ * that would be pushed beyond the edges of the grid is carried over to the
+ * same pixel within the next frame instead, so that no light gets lost.
+ *
+ * The encoder keeps a shadow of the color each pixel has been sent last, and
+ * only sends the pixels whose color has changed. Each changed pixel is either
+ * sent on its own by {@link PROTOCOL_COMMAND_QUEUE_COLOR}, or as part of a
+ * run of consecutive pixels by {@link PROTOCOL_COMMAND_QUEUE_FRAME}, which
+ * costs less per pixel, but also carries the unchanged pixels within the
+ * run. The cheapest combination is found by dynamic programming over the
+ * chain. Segments whose pixels all share the same color are encoded into a
+ * single broadcast instead, if that is even cheaper.
+ *
+ * Frames might get lost on the bus, so a few pixels of each segment are sent
+ * in every frame regardless, until all of them have been refreshed within
+ * {@link #ENCODER_REFRESH_PERIOD} frames.
+ *
+ * @see encoder.h
+ */
+
+#include <stdlib.h>
+
+#include "encoder.h"
+#include "frame.h"
+#include "protocol.h"
+#include "pwm_table.h"
+
+/**
+ * @brief Amount of channels per pixel
+ */
+#define ENCODER_CHANNELS 3
+
+/**
+ * @brief Amount of frames within which each pixel is sent at least once
+ */
+#define ENCODER_REFRESH_PERIOD 64
+
+/**
+ * @brief Bytes needed to send a single pixel on its own
+ */
+#define ENCODER_COST_SINGLE ENCODER_FRAME_SIZE
+
+/**
+ * @brief Bytes needed to send a run of the given amount of pixels
+ */
+#define ENCODER_COST_RUN(pixels) (5 + 2 + 3 * (pixels))
+
+/**
+ * @brief Maximum amount of pixels within a single run
+ */
+#define ENCODER_RUN_MAX ((UINT8_MAX - 2) / 3)
+
+/**
+ * @brief Maximum amount of pixels within a single segment
+ */
+#define ENCODER_CHAIN_MAX UINT8_MAX
+
+/**
+ * @brief Size of the Bayer matrix used for ordered dithering
+ */
+#define ENCODER_BAYER_SIZE 4
+
+/**
+ * Thresholds of the Bayer matrix, in sixteenths minus one half
+ */
+static const uint8_t encoder_bayer[ENCODER_BAYER_SIZE][ENCODER_BAYER_SIZE] = {
+
+    {0, 8, 2, 10},
+    {12, 4, 14, 6},
+    {3, 11, 1, 9},
+    {15, 7, 13, 5},
+
+};
+
+struct encoder {
+
+    /**
+     * @brief Layout of the pixels being encoded
+     */
+    const layout_t* layout;
+
+    /**
+     * @brief Gain of each channel of each pixel
+     */
+    uint16_t* gains;
+
+    /**
+     * @brief Step of the PWM table closest to each linear value
+     */
+    uint8_t inverse[UINT16_MAX + 1];
+
+    /**
+     * @brief Highest step of the PWM table not exceeding each linear value
+     */
+    uint8_t lower[UINT16_MAX + 1];
+
+    /**
+     * @brief Next step of the PWM table emitting more light than each step
+     */
+    uint8_t upper[256];
+
+    /**
+     * @brief Light emitted by each step of the PWM table
+     */
+    uint16_t table[256];
+
+    /**
+     * @brief Dithering being applied
+     */
+    int dither;
+
+    /**
+     * @brief Error of each channel of each pixel carried over to the next
+     * frame, in sixteenths
+     */
+    int32_t* carry;
+
+    /**
+     * @brief Error diffused into the current and the next row, in sixteenths
+     */
+    int32_t* rows[2];
+
+    /**
+     * @brief Color each pixel has been sent last
+     */
+    color_rgb_t* shadow;
+
+    /**
+     * @brief Whether the shadow of each pixel is known
+     */
+    uint8_t* known;
+
+    /**
+     * @brief Address of the next pixel to be refreshed within each segment
+     */
+    unsigned int refresh[DRIVER_SEGMENTS_MAX];
+
+    /**
+     * @brief Least amount of bytes needed to send the pixels in front of
+     * each address
+     */
+    unsigned int cost[ENCODER_CHAIN_MAX + 1];
+
+    /**
+     * @brief Amount of pixels sent by the last frame of the cheapest way,
+     * zero if the pixel isn't sent at all
+     */
+    uint8_t run[ENCODER_CHAIN_MAX + 1];
+
+};
+
+/**
+ * Fills in the inverses of the PWM table
+ *
+ * Values in between two steps are mapped to the closer one. The table holds
+ * the same value for multiple consecutive steps at its lower end, in which
+ * case the first of these steps is used.
+ *
+ * @param encoder Encoder to fill in the inverses of
+ */
+static void encoder_invert(struct encoder* encoder)
+{
+
+    static const uint16_t table[256] = PWM_TABLE;
+    unsigned int step = 0;
+
+    for (unsigned int i = 0; i < 256; i++) {
+
+        unsigned int next = i + 1;
+
+        while (next < 256 && table[next] == table[i]) {
+
+            next++;
+
+        }
+
+        encoder->table[i] = table[i];
+        encoder->upper[i] = (next < 256) ? next : i;
+
+    }
+
+    for (uint32_t value = 0; value <= UINT16_MAX; value++) {
+
+        // Advance to the highest step not exceeding the value
+        while (encoder->upper[step] != step
+            && table[encoder->upper[step]] <= value) {
+
+            step = encoder->upper[step];
+
+        }
+
+        unsigned int next = encoder->upper[step];
+
+        encoder->lower[value] = step;
+        encoder->inverse[value] = (next != step
+            && table[next] - value < value - table[step]) ? next : step;
+
+    }
+
+}
+
+/**
+ * Creates an encoder
+ *
+ * All pixels start out without any attenuation.
+ *
+ * @param layout Layout of the pixels, which needs to outlive the encoder
+ *
+ * @return Encoder, or NULL if out of memory
+ */
+encoder_t* encoder_create(const layout_t* layout)
+{
+
+    struct encoder* encoder = malloc(sizeof(*encoder));
+    size_t pixels = (size_t)layout->width * layout->height;
+
+    if (!encoder) {
+
+        return NULL;
+
+    }
+
+    encoder->layout = layout;
+    encoder->gains = malloc(pixels * ENCODER_CHANNELS
+        * sizeof(*encoder->gains));
+    encoder->shadow = malloc(pixels * sizeof(*encoder->shadow));
+    encoder->known = calloc(pixels, sizeof(*encoder->known));
+    encoder->dither = ENCODER_DITHER_NONE;
+    encoder->carry = calloc(pixels * ENCODER_CHANNELS,
+        sizeof(*encoder->carry));
+    encoder->rows[0] = calloc(layout->width * ENCODER_CHANNELS,
+        sizeof(*encoder->rows[0]));
+    encoder->rows[1] = calloc(layout->width * ENCODER_CHANNELS,
+        sizeof(*encoder->rows[1]));
+
+    if (!encoder->gains || !encoder->shadow || !encoder->known
+        || !encoder->carry || !encoder->rows[0] || !encoder->rows[1]) {
+
+        encoder_destroy(encoder);
+
+        return NULL;
+
+    }
+
+    for (int i = 0; i < DRIVER_SEGMENTS_MAX; i++) {
+
+        encoder->refresh[i] = 0;
+
+    }
+
+    for (size_t i = 0; i < pixels * ENCODER_CHANNELS; i++) {
+
+        encoder->gains[i] = ENCODER_GAIN_UNITY;
+
+    }
+
+    encoder_invert(encoder);
+
+    return encoder;
+
+}
+
+/**
+ * Destroys an encoder
+ *
+ * @param encoder Encoder to destroy
+ */
+void encoder_destroy(encoder_t* encoder)
+{
+
+    free(encoder->rows[1]);
+    free(encoder->rows[0]);
+    free(encoder->carry);
+    free(encoder->known);
+    free(encoder->shadow);
+    free(encoder->gains);
+    free(encoder);
+
+}
+
+/**
+ * Forgets about the colors the pixels have been sent
+ *
+ * This causes all of the pixels to be sent with the next frame, e.g. after
+ * they have been reset.
+ *
+ * @param encoder Encoder to reset the shadow of
+ */
+void encoder_invalidate(encoder_t* encoder)
+{
+
+    size_t pixels = (size_t)encoder->layout->width * encoder->layout->height;
+
+    for (size_t i = 0; i < pixels; i++) {
+
+        encoder->known[i] = 0;
+
+    }
+
+}
+
+/**
+ * Sets the calibration of a single pixel
+ *
+ * The calibration attenuates each channel of the pixel, so that pixels with
+ * brighter LEDs match the others.
+ *
+ * @param encoder Encoder to set the calibration of
+ * @param index Index of the pixel within the grid
+ * @param gain Gain of the red, green and blue channel, with
+ * {@link #ENCODER_GAIN_UNITY} leaving the channel as it is
+ */
+void encoder_set_gain(encoder_t* encoder, size_t index, const uint16_t* gain)
+{
+
+    for (int i = 0; i < ENCODER_CHANNELS; i++) {
+
+        encoder->gains[index * ENCODER_CHANNELS + i] = gain[i];
+
+    }
+
+}
+
+/**
+ * Sets the dithering applied when quantizing
+ *
+ * @param encoder Encoder to set the dithering of
+ * @param dither {@link #ENCODER_DITHER_NONE},
+ * {@link #ENCODER_DITHER_ORDERED} or {@link #ENCODER_DITHER_DIFFUSION}
+ */
+void encoder_set_dither(encoder_t* encoder, int dither)
+{
+
+    size_t pixels = (size_t)encoder->layout->width * encoder->layout->height;
+
+    encoder->dither = dither;
+
+    for (size_t i = 0; i < pixels * ENCODER_CHANNELS; i++) {
+
+        encoder->carry[i] = 0;
+
+    }
+
+}
+
+/**
+ * Quantizes a single value using ordered dithering
+ *
+ * @param encoder Encoder to use
+ * @param value Linear value to quantize
+ * @param threshold Threshold from the Bayer matrix
+ *
+ * @return Step of the PWM table
+ */
+static uint8_t encoder_quantize_ordered(encoder_t* encoder, uint16_t value,
+    uint8_t threshold)
+{
+
+    uint8_t lower = encoder->lower[value];
+    uint8_t upper = encoder->upper[lower];
+    uint32_t above = value - encoder->table[lower];
+    uint32_t range = encoder->table[upper] - encoder->table[lower];
+
+    return (32 * above > (2 * threshold + 1) * range) ? upper : lower;
+
+}
+
+/**
+ * Quantizes a single row using error diffusion
+ *
+ * @param encoder Encoder to use
+ * @param y Row to quantize
+ * @param values Linear values of the row, after calibration
+ * @param steps Pointer the steps of the row are stored at
+ */
+static void encoder_quantize_diffusion(encoder_t* encoder, unsigned int y,
+    const uint16_t* values, uint8_t* steps)
+{
+
+    unsigned int width = encoder->layout->width;
+    int last = (y + 1 == encoder->layout->height);
+    int32_t* current = encoder->rows[y & 1];
+    int32_t* next = encoder->rows[!(y & 1)];
+    int32_t* carry = encoder->carry + (size_t)y * width * ENCODER_CHANNELS;
+
+    for (unsigned int i = 0; i < width * ENCODER_CHANNELS; i++) {
+
+        next[i] = 0;
+
+    }
+
+    for (unsigned int i = 0; i < width; i++) {
+
+        // Serpentine, so that the error isn't always pushed to the right
+        unsigned int x = (y & 1) ? width - 1 - i : i;
+        int ahead = (y & 1) ? -1 : 1;
+        int has_ahead = (i + 1 < width);
+        int has_behind = (i > 0);
+
+        for (int j = 0; j < ENCODER_CHANNELS; j++) {
+
+            unsigned int k = x * ENCODER_CHANNELS + j;
+            int32_t target = values[k] + (current[k] + carry[k]) / 16;
+
+            if (target < 0) {
+
+                target = 0;
+
+            } else if (target > UINT16_MAX) {
+
+                target = UINT16_MAX;
+
+            }
+
+            steps[k] = encoder->inverse[target];
+
+            int32_t error = target - encoder->table[steps[k]];
+            int32_t lost = 0;
+
+            carry[k] = 0;
+
+            if (has_ahead) {
+
+                current[k + ahead * ENCODER_CHANNELS] += 7 * error;
+
+            } else {
+
+                lost += 7 * error;
+
+            }
+
+            if (last) {
+
+                lost += 9 * error;
+
+            } else {
+
+                next[k] += 5 * error;
+
+                if (has_behind) {
+
+                    next[k - ahead * ENCODER_CHANNELS] += 3 * error;
+
+                } else {
+
+                    lost += 3 * error;
+
+                }
+
+                if (has_ahead) {
+
+                    next[k + ahead * ENCODER_CHANNELS] += error;
+
+                } else {
+
+                    lost += error;
+
+                }
+
+            }
+
+            carry[k] = lost;
+
+        }
+
+    }
+
+}
+
+/**
+ * Calibrates and quantizes a rendered frame
+ *
+ * @param encoder Encoder to use
+ * @param linear Rendered frame, with the red, green and blue channel of each
+ * pixel of the grid, row by row
+ * @param colors Pointer the resulting colors are stored at, one per pixel
+ */
+void encoder_quantize(encoder_t* encoder, const uint16_t* linear,
+    color_rgb_t* colors)
+{
+
+    unsigned int width = encoder->layout->width;
+    unsigned int height = encoder->layout->height;
+    const uint16_t* gain = encoder->gains;
+    uint16_t values[width * ENCODER_CHANNELS];
+    uint8_t steps[width * ENCODER_CHANNELS];
+
+    for (unsigned int i = 0; i < width * ENCODER_CHANNELS; i++) {
+
+        encoder->rows[0][i] = 0;
+
+    }
+
+    for (unsigned int y = 0; y < height; y++) {
+
+        for (unsigned int i = 0; i < width * ENCODER_CHANNELS; i++) {
+
+            values[i] = (uint32_t)linear[i] * gain[i] / UINT16_MAX;
+
+        }
+
+        switch (encoder->dither) {
+
+            case ENCODER_DITHER_ORDERED:
+
+                for (unsigned int i = 0; i < width * ENCODER_CHANNELS; i++) {
+
+                    uint8_t threshold = encoder_bayer[y % ENCODER_BAYER_SIZE]
+                        [i / ENCODER_CHANNELS % ENCODER_BAYER_SIZE];
+
+                    steps[i] = encoder_quantize_ordered(encoder, values[i],
+                        threshold);
+
+                }
+
+                break;
+
+            case ENCODER_DITHER_DIFFUSION:
+
+                encoder_quantize_diffusion(encoder, y, values, steps);
+
+                break;
+
+            default:
+
+                for (unsigned int i = 0; i < width * ENCODER_CHANNELS; i++) {
+
+                    steps[i] = encoder->inverse[values[i]];
+
+                }
+
+                break;
+
+        }
+
+        for (unsigned int x = 0; x < width; x++) {
+
+            colors[x].red = steps[x * ENCODER_CHANNELS];
+            colors[x].green = steps[x * ENCODER_CHANNELS + 1];
+            colors[x].blue = steps[x * ENCODER_CHANNELS + 2];
+
+        }
+
+        linear += width * ENCODER_CHANNELS;
+        gain += width * ENCODER_CHANNELS;
+        colors += width;
+
+    }
+
+}
+
+/**
+ * Checks whether two colors are the same
+ *
+ * @param a First color
+ * @param b Second color
+ *
+ * @return Non-zero value if the colors are the same
+ */
+static int encoder_equal(const color_rgb_t* a, const color_rgb_t* b)
+{
+
+    return a->red == b->red && a->green == b->green && a->blue == b->blue;
+
+}
+
+/**
+ * Checks whether a pixel needs to be sent
+ *
+ * @param encoder Encoder to check the shadow of
+ * @param index Index of the pixel within the grid
+ * @param color Color of the pixel to be sent
+ *
+ * @return Non-zero value if the color differs from the shadow
+ */
+static int encoder_is_dirty(encoder_t* encoder, size_t index,
+    const color_rgb_t* color)
+{
+
+    return !encoder->known[index]
+        || !encoder_equal(&encoder->shadow[index], color);
+
+}
+
+/**
+ * Encodes a run of consecutive pixels of a segment
+ *
+ * @param encoder Encoder to use
+ * @param chain Indices of the pixels of the segment
+ * @param colors Colors of all pixels of the grid
+ * @param latch Time the colors are to be presented at in ticks
+ * @param first Address of the first pixel of the run
+ * @param pixels Amount of pixels within the run
+ * @param buffer Buffer the frame is written to
+ *
+ * @return Amount of bytes written to the buffer
+ */
+static size_t encoder_encode_run(encoder_t* encoder, const size_t* chain,
+    const color_rgb_t* colors, uint16_t latch, unsigned int first,
+    unsigned int pixels, uint8_t* buffer)
+{
+
+    uint8_t payload[2 + 3 * ENCODER_RUN_MAX] = {latch, latch >> 8};
+    uint8_t length = 2;
+
+    for (unsigned int i = first; i < first + pixels; i++) {
+
+        const color_rgb_t* color = &colors[chain[i]];
+
+        payload[length++] = color->red;
+        payload[length++] = color->green;
+        payload[length++] = color->blue;
+
+        encoder->shadow[chain[i]] = *color;
+        encoder->known[chain[i]] = 1;
+
+    }
+
+    if (pixels == 1) {
+
+        return frame_encode(buffer, PROTOCOL_COMMAND_QUEUE_COLOR, first,
+            payload, length, 0);
+
+    }
+
+    return frame_encode(buffer, PROTOCOL_COMMAND_QUEUE_FRAME, first, payload,
+        length, 0);
+
+}
+
+/**
+ * Encodes the changed colors of a single segment
+ *
+ * @param encoder Encoder to use
+ * @param segment Segment to encode
+ * @param colors Colors of all pixels of the grid, as quantized before
+ * @param latch Time the colors are to be presented at in ticks
+ * @param buffer Buffer the frames are written to, which needs to hold
+ * {@link #ENCODER_FRAME_SIZE} bytes for each pixel of the segment
+ *
+ * @return Amount of bytes written to the buffer
+ */
+size_t encoder_encode(encoder_t* encoder, int segment,
+    const color_rgb_t* colors, uint16_t latch, uint8_t* buffer)
+{
+
+    const size_t* chain = encoder->layout->chains[segment];
+    unsigned int length = encoder->layout->lengths[segment];
+    unsigned int refresh = encoder->refresh[segment];
+    unsigned int refreshed = (length + ENCODER_REFRESH_PERIOD - 1)
+        / ENCODER_REFRESH_PERIOD;
+    unsigned int* cost = encoder->cost;
+    uint8_t* run = encoder->run;
+    int uniform = 1;
+
+    encoder->refresh[segment] = (refresh + refreshed) % length;
+
+    // Find the cheapest way to send all pixels in front of each address
+    cost[0] = 0;
+
+    for (unsigned int i = 1; i <= length; i++) {
+
+        size_t index = chain[i - 1];
+
+        uniform &= encoder_equal(&colors[index], &colors[chain[0]]);
+
+        if (!encoder_is_dirty(encoder, index, &colors[index])
+            && (i - 1 + length - refresh) % length >= refreshed) {
+
+            cost[i] = cost[i - 1];
+            run[i] = 0;
+
+            continue;
+
+        }
+
+        cost[i] = cost[i - 1] + ENCODER_COST_SINGLE;
+        run[i] = 1;
+
+        for (unsigned int n = 2; n <= i && n <= ENCODER_RUN_MAX; n++) {
+
+            if (cost[i - n] + ENCODER_COST_RUN(n) < cost[i]) {
+
+                cost[i] = cost[i - n] + ENCODER_COST_RUN(n);
+                run[i] = n;
+
+            }
+
+        }
+
+    }
+
+    if (uniform && cost[length] > ENCODER_COST_SINGLE) {
+
+        uint8_t payload[5] = {latch, latch >> 8, colors[chain[0]].red,
+            colors[chain[0]].green, colors[chain[0]].blue};
+
+        for (unsigned int i = 0; i < length; i++) {
+
+            encoder->shadow[chain[i]] = colors[chain[0]];
+            encoder->known[chain[i]] = 1;
+
+        }
+
+        return frame_encode(buffer, PROTOCOL_COMMAND_QUEUE_COLOR,
+            PROTOCOL_ADDRESS_BROADCAST, payload, sizeof(payload), 0);
+
+    }
+
+    // Walk back the cheapest way, remembering where each frame ends
+    unsigned int ends[ENCODER_CHAIN_MAX];
+    unsigned int frames = 0;
+
+    for (unsigned int i = length; i > 0; ) {
+
+        if (run[i]) {
+
+            ends[frames++] = i;
+            i -= run[i];
+
+        } else {
+
+            i--;
+
+        }
+
+    }
+
+    size_t size = 0;
+
+    while (frames--) {
+
+        unsigned int end = ends[frames];
+
+        size += encoder_encode_run(encoder, chain, colors, latch,
+            end - run[end], run[end], buffer + size);
+
+    }
+
+    return size;
+
+}
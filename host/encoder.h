@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file encoder.h
+ *
+ * Encoding of rendered frames into frames of the protocol
+ *
+ * Frames are rendered in linear light, i.e. with values proportional to the
+ * light the LEDs are supposed to emit, with 16 bits per channel. The encoder
+ * applies the calibration of each pixel, quantizes the result to the steps of
+ * the {@link pwm_table.h PWM table} (optionally
+ * {@link encoder_set_dither() dithered}) and encodes the steps of the pixels
+ * that have changed into frames queueing them for each
+ * {@link layout.h segment}.
+ *
+ * @see encoder.c
+ */
+
+#ifndef _LTT_HOST_ENCODER_H_
+#define _LTT_HOST_ENCODER_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "color.h"
+#include "layout.h"
+
+/**
+ * @brief Size of a frame queueing the color of a single pixel
+ */
+#define ENCODER_FRAME_SIZE (5 + 5)
+
+/**
+ * @brief Gain of a channel that isn't attenuated by the calibration
+ */
+#define ENCODER_GAIN_UNITY UINT16_MAX
+
+/**
+ * @brief Quantization without any dithering
+ */
+#define ENCODER_DITHER_NONE 0
+
+/**
+ * @brief Quantization with ordered dithering
+ *
+ * This doesn't change the colors of static content over time, so static
+ * content still doesn't need to be sent again.
+ */
+#define ENCODER_DITHER_ORDERED 1
+
+/**
+ * @brief Quantization with error diffusion
+ *
+ * This gets closer to the rendered frame than ordered dithering. However,
+ * the error carried over from frame to frame keeps the pattern moving, so
+ * even static content needs to be sent again most of the time.
+ */
+#define ENCODER_DITHER_DIFFUSION 2
+
+/**
+ * Encoder for the pixels of a table
+ */
+typedef struct encoder encoder_t;
+
+encoder_t* encoder_create(const layout_t* layout);
+void encoder_destroy(encoder_t* encoder);
+
+void encoder_invalidate(encoder_t* encoder);
+
+void encoder_set_gain(encoder_t* encoder, size_t index,
+    const uint16_t* gain);
+void encoder_set_dither(encoder_t* encoder, int dither);
+
+void encoder_quantize(encoder_t* encoder, const uint16_t* linear,
+    color_rgb_t* colors);
+size_t encoder_encode(encoder_t* encoder, int segment,
+    const color_rgb_t* colors, uint16_t latch, uint8_t* buffer);
+
+#endif /* _LTT_HOST_ENCODER_H_ */
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file frame.c
+ *
+ * Implements the encoding of frames declared in frame.h
+ *
+ * @see frame.h
+ */
+
+#include "frame.h"
+
+#include "crc.h"
+#include "fec.h"
+#include "protocol.h"
+
+/**
+ * Appends a single byte of a frame to the given buffer
+ *
+ * @param buffer Buffer the byte is appended to
+ * @param byte Byte to append
+ * @param fec Non-zero value if the byte is to be encoded into codewords
+ *
+ * @return Amount of bytes appended
+ */
+static size_t frame_put(uint8_t* buffer, uint8_t byte, int fec)
+{
+
+    if (!fec) {
+
+        buffer[0] = byte;
+
+        return 1;
+
+    }
+
+    buffer[0] = fec_encode(byte & 0x0F);
+    buffer[1] = fec_encode(byte >> 4);
+
+    return 2;
+
+}
+
+/**
+ * Encodes a frame into the given buffer
+ *
+ * @param buffer Buffer of at least {@link #FRAME_SIZE_MAX} bytes
+ * @param command Command of the frame
+ * @param address Address of the frame
+ * @param payload Payload of the frame
+ * @param length Amount of payload bytes
+ * @param fec Non-zero value for a frame with forward error correction
+ *
+ * @return Amount of bytes encoded into the buffer
+ */
+size_t frame_encode(uint8_t* buffer, uint8_t command, uint8_t address,
+    const uint8_t* payload, uint8_t length, int fec)
+{
+
+    size_t size = 0;
+
+    buffer[size++] = fec ? PROTOCOL_SYNC_FEC : PROTOCOL_SYNC;
+
+    uint8_t crc = crc8_update(0, command);
+    crc = crc8_update(crc, address);
+    crc = crc8_update(crc, length);
+
+    size += frame_put(buffer + size, command, fec);
+    size += frame_put(buffer + size, address, fec);
+    size += frame_put(buffer + size, length, fec);
+
+    for (uint8_t i = 0; i < length; i++) {
+
+        crc = crc8_update(crc, payload[i]);
+        size += frame_put(buffer + size, payload[i], fec);
+
+    }
+
+    size += frame_put(buffer + size, crc, fec);
+
+    return size;
+
+}
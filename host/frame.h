@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file frame.h
+ *
+ * Encoding of frames on the host
+ *
+ * This is used by the tools running on the host to build frames in the
+ * format described in protocol.h, optionally protected by forward error
+ * correction.
+ *
+ * @see frame.c
+ */
+
+#ifndef _LTT_HOST_FRAME_H_
+#define _LTT_HOST_FRAME_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+/**
+ * @brief Maximum amount of payload bytes of a single frame
+ */
+#define FRAME_PAYLOAD_MAX UINT8_MAX
+
+/**
+ * @brief Size of a buffer large enough for any encoded frame
+ *
+ * This accounts for the sync byte and the doubled length of all of the other
+ * bytes when using forward error correction.
+ */
+#define FRAME_SIZE_MAX (1 + 2 * (4 + FRAME_PAYLOAD_MAX))
+
+size_t frame_encode(uint8_t* buffer, uint8_t command, uint8_t address,
+    const uint8_t* payload, uint8_t length, int fec);
+
+#endif /* _LTT_HOST_FRAME_H_ */
@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file fuzz.c
+ *
+ * Fuzzing harness for the parser of the protocol
+ *
+ * Each input is fed byte by byte into protocol_process() of a
+ * {@link sim.h simulated pixel}, the same way the receive interrupt of the
+ * bus does on the pixel itself. For each byte the following is asserted:
+ *
+ * - No more than two bytes are forwarded (the two codewords of a corrected
+ *   byte of a frame with forward error correction).
+ * - Commands only take effect with the byte completing a valid frame.
+ * - The parser doesn't stay within a frame for longer than the longest
+ *   possible frame, so it can never get stuck.
+ * - Processing the byte takes less CPU time than {@link #FUZZ_BYTE_TIME}.
+ *
+ * Furthermore, the CPU time spent on average over all of the bytes processed
+ * so far must stay below {@link #FUZZ_BYTE_TIME_AVERAGE}. Single bytes can be
+ * delayed by interrupts of the host, so the bound per byte is rather loose.
+ *
+ * At the end of each input, zeros are fed into the parser until it is idle
+ * again, and all of the bytes received must have been forwarded by then.
+ * This also leaves the parser in a known state for the next input.
+ *
+ * It can be built for libFuzzer with:
+ *
+ * \code
+ *  clang -std=gnu99 -g -O1 -fsanitize=fuzzer,address,undefined -DFUZZ_LIBFUZZER \
+ *      -I../src -o fuzz fuzz.c sim.c ../src/protocol.c ../src/crc.c ../src/fec.c
+ * \endcode
+ *
+ * Otherwise it reads the input from the files given as arguments (or the
+ * standard input), which is what AFL expects, e.g. when built with
+ * `afl-clang-fast` instead. This is also useful to replay a crashing input.
+ *
+ * Seeds for the corpus can be created with the {@link encode.c encoder},
+ * e.g. by concatenating recorded frames:
+ *
+ * \code
+ *  mkdir corpus
+ *  ./encode 0x01 0xff 255 128 0 > corpus/set_color
+ *  ./encode -f 0x03 0xff 0 0x10 0x27 4 > corpus/sync_clock
+ *  ./encode 0x02 0xff 0 0 0 > corpus/collect_touch
+ *  ./encode 0x0a 0x00 1 255 0 0 0 255 0 > corpus/set_cluster
+ * \endcode
+ *
+ * @see sim.h
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bus.h"
+#include "frame.h"
+#include "protocol.h"
+#include "sim.h"
+
+#ifndef FUZZ_BYTE_TIME_AVERAGE
+
+    /**
+     * @brief Upper bound of the average CPU time spent per byte in ns
+     *
+     * The pixel has to keep up with bytes arriving every
+     * {@link #BUS_BYTE_TIME}. The host is a lot faster than the pixel, so
+     * exceeding this on the host means processing isn't bounded at all.
+     */
+    #define FUZZ_BYTE_TIME_AVERAGE (BUS_BYTE_TIME * 1000ULL)
+
+#endif
+
+#ifndef FUZZ_BYTE_TIME
+
+    /**
+     * @brief Upper bound of the CPU time spent on a single byte in ns
+     */
+    #define FUZZ_BYTE_TIME (FUZZ_BYTE_TIME_AVERAGE * 25)
+
+#endif
+
+/**
+ * @brief Amount of bytes to process before the average is checked
+ */
+#define FUZZ_AVERAGE_BYTES 1024
+
+/**
+ * Amount of bytes processed since the parser has been idle the last time
+ */
+static size_t fuzz_busy = 0;
+
+/**
+ * Amount of bytes processed in total
+ */
+static unsigned long long fuzz_bytes = 0;
+
+/**
+ * CPU time spent on processing bytes in total
+ */
+static unsigned long long fuzz_elapsed = 0;
+
+/**
+ * Returns the CPU time consumed by the current thread
+ *
+ * @return CPU time in nanoseconds
+ */
+static unsigned long long fuzz_time()
+{
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+
+}
+
+/**
+ * Processes a single byte and checks the assertions
+ *
+ * @param byte Byte to process
+ */
+static void fuzz_process(uint8_t byte)
+{
+
+    sim_counters_t before;
+    sim_counters_t after;
+
+    sim_get_counters(&before);
+    unsigned long long start = fuzz_time();
+
+    protocol_process(byte);
+
+    unsigned long long elapsed = fuzz_time() - start;
+    sim_get_counters(&after);
+
+    assert(after.sent - before.sent <= 2);
+    assert(after.effects == before.effects || after.frames != before.frames);
+    assert(elapsed < FUZZ_BYTE_TIME);
+
+    fuzz_bytes++;
+    fuzz_elapsed += elapsed;
+
+    fuzz_busy = protocol_is_idle() ? 0 : fuzz_busy + 1;
+
+    assert(fuzz_busy < FRAME_SIZE_MAX);
+
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+
+    sim_counters_t before;
+    sim_counters_t after;
+
+    sim_get_counters(&before);
+
+    for (size_t i = 0; i < size; i++) {
+
+        fuzz_process(data[i]);
+
+    }
+
+    size_t drained = 0;
+
+    while (!protocol_is_idle()) {
+
+        fuzz_process(0);
+        drained++;
+
+    }
+
+    sim_get_counters(&after);
+
+    assert(after.sent - before.sent == size + drained);
+    assert(fuzz_bytes < FUZZ_AVERAGE_BYTES
+        || fuzz_elapsed < fuzz_bytes * FUZZ_BYTE_TIME_AVERAGE);
+
+    protocol_set_address(PROTOCOL_ADDRESS_UNKNOWN);
+    sim_set_touched(size & 1);
+
+    return 0;
+
+}
+
+#ifndef FUZZ_LIBFUZZER
+
+/**
+ * Reads a whole input and runs it
+ *
+ * @param file File to read the input from
+ *
+ * @return Zero on success, -1 otherwise
+ */
+static int fuzz_run_file(FILE* file)
+{
+
+    static uint8_t buffer[1 << 20];
+    size_t size = fread(buffer, 1, sizeof(buffer), file);
+
+    if (ferror(file)) {
+
+        return -1;
+
+    }
+
+    LLVMFuzzerTestOneInput(buffer, size);
+
+    return 0;
+
+}
+
+int main(int argc, char* argv[])
+{
+
+    if (argc < 2) {
+
+        return fuzz_run_file(stdin) ? EXIT_FAILURE : EXIT_SUCCESS;
+
+    }
+
+    for (int i = 1; i < argc; i++) {
+
+        FILE* file = fopen(argv[i], "rb");
+
+        if (!file || fuzz_run_file(file)) {
+
+            perror(argv[i]);
+
+            return EXIT_FAILURE;
+
+        }
+
+        fclose(file);
+
+    }
+
+    return EXIT_SUCCESS;
+
+}
+
+#endif
@@ -0,0 +1,333 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file ingest.c
+ *
+ * Implements the ingestion of video declared in ingest.h
+ *
+ * Each pixel of the grid covers a box of whole rows and columns of the
+ * video, with the boundaries rounded down. Each byte of a row is converted
+ * into linear light by means of a table with 256 entries, assuming the video
+ * uses the sRGB transfer function. The converted rows of a box are summed up
+ * first, which is where most of the work is, so this is done with SSE2 eight
+ * values at a time (if available). The columns of the summed up rows are
+ * then summed up for each box.
+ *
+ * Averaging has to happen in linear light, as the light emitted by a pixel
+ * is the average of the light within its box. Averaging the values as
+ * encoded within the video would make e.g. a fine checkerboard of black and
+ * white come out at about a fifth of full brightness rather than at half.
+ *
+ * @see ingest.h
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "ingest.h"
+
+struct ingest {
+
+    /**
+     * @brief File the video is read from
+     */
+    FILE* input;
+
+    /**
+     * @brief Amount of pixels per row of the video
+     */
+    unsigned int width;
+
+    /**
+     * @brief Amount of rows of the video
+     */
+    unsigned int height;
+
+    /**
+     * @brief Frames per second of the video
+     */
+    double rate;
+
+    /**
+     * @brief Amount of frames read so far
+     */
+    unsigned long frames;
+
+    /**
+     * @brief Layout of the pixels the video is scaled down to
+     */
+    const layout_t* layout;
+
+    /**
+     * @brief Last frame read
+     */
+    uint8_t* frame;
+
+    /**
+     * @brief Sums of the rows of the box currently being averaged
+     */
+    uint32_t* sums;
+
+    /**
+     * @brief First column of each box, plus the end of the last one
+     */
+    unsigned int* columns;
+
+    /**
+     * @brief Linear light of each value encoded within the video
+     */
+    uint16_t linear[UINT8_MAX + 1];
+
+};
+
+/**
+ * Opens a video for ingestion
+ *
+ * @param input File to read the video from
+ * @param width Amount of pixels per row of the video
+ * @param height Amount of rows of the video
+ * @param rate Frames per second of the video
+ * @param layout Layout to scale the video down to, which needs to outlive
+ * the ingestion and to have no more pixels than the video in either
+ * direction
+ *
+ * @return Ingestion, or NULL on failure (including boxes too tall for their
+ * sums to fit into 32 bits)
+ */
+ingest_t* ingest_open(FILE* input, unsigned int width, unsigned int height,
+    double rate, const layout_t* layout)
+{
+
+    if (width < layout->width || height < layout->height || rate <= 0
+        || height / layout->height >= UINT32_MAX / UINT16_MAX) {
+
+        return NULL;
+
+    }
+
+    struct ingest* ingest = malloc(sizeof(*ingest));
+
+    if (!ingest) {
+
+        return NULL;
+
+    }
+
+    ingest->input = input;
+    ingest->width = width;
+    ingest->height = height;
+    ingest->rate = rate;
+    ingest->frames = 0;
+    ingest->layout = layout;
+    ingest->frame = malloc((size_t)width * height * 3);
+    ingest->sums = malloc((size_t)width * 3 * sizeof(*ingest->sums));
+    ingest->columns = malloc((layout->width + 1) * sizeof(*ingest->columns));
+
+    if (!ingest->frame || !ingest->sums || !ingest->columns) {
+
+        ingest_close(ingest);
+
+        return NULL;
+
+    }
+
+    for (unsigned int x = 0; x <= layout->width; x++) {
+
+        ingest->columns[x] = (uint64_t)x * width / layout->width;
+
+    }
+
+    for (unsigned int i = 0; i <= UINT8_MAX; i++) {
+
+        double value = i / 255.0;
+
+        value = (value <= 0.04045) ? value / 12.92
+            : pow((value + 0.055) / 1.055, 2.4);
+
+        ingest->linear[i] = (value >= 1) ? UINT16_MAX
+            : (uint16_t)(value * UINT16_MAX + 0.5);
+
+    }
+
+    return ingest;
+
+}
+
+/**
+ * Closes the ingestion of a video
+ *
+ * The file the video is read from isn't closed.
+ *
+ * @param ingest Ingestion to close
+ */
+void ingest_close(ingest_t* ingest)
+{
+
+    free(ingest->columns);
+    free(ingest->sums);
+    free(ingest->frame);
+    free(ingest);
+
+}
+
+/**
+ * Adds a row of the video to the sums
+ *
+ * Each byte is converted into linear light as it is added, so that the sums
+ * are sums of light. The table lookups can't be vectorized with SSE2, but the
+ * widening and adding of eight values at a time can.
+ *
+ * @param ingest Ingestion the row belongs to
+ * @param row Row to add
+ * @param size Amount of bytes within the row
+ */
+static void ingest_add_row(ingest_t* ingest, const uint8_t* row, size_t size)
+{
+
+    const uint16_t* linear = ingest->linear;
+    uint32_t* sums = ingest->sums;
+    size_t i = 0;
+
+#ifdef __SSE2__
+
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; i + 8 <= size; i += 8) {
+
+        __m128i values = _mm_setr_epi16(linear[row[i]], linear[row[i + 1]],
+            linear[row[i + 2]], linear[row[i + 3]], linear[row[i + 4]],
+            linear[row[i + 5]], linear[row[i + 6]], linear[row[i + 7]]);
+        __m128i* sum = (__m128i*)(sums + i);
+
+        _mm_storeu_si128(sum, _mm_add_epi32(_mm_loadu_si128(sum),
+            _mm_unpacklo_epi16(values, zero)));
+        _mm_storeu_si128(sum + 1, _mm_add_epi32(_mm_loadu_si128(sum + 1),
+            _mm_unpackhi_epi16(values, zero)));
+
+    }
+
+#endif
+
+    for (; i < size; i++) {
+
+        sums[i] += linear[row[i]];
+
+    }
+
+}
+
+/**
+ * Scales a single frame of the video down to the grid
+ *
+ * @param ingest Ingestion the frame belongs to
+ * @param frame Frame of the video
+ * @param linear Pointer the scaled frame is stored at, with the red, green
+ * and blue channel of each pixel of the grid, row by row
+ */
+void ingest_scale(ingest_t* ingest, const uint8_t* frame, uint16_t* linear)
+{
+
+    const layout_t* layout = ingest->layout;
+    size_t stride = (size_t)ingest->width * 3;
+
+    for (unsigned int y = 0; y < layout->height; y++) {
+
+        unsigned int top = (uint64_t)y * ingest->height / layout->height;
+        unsigned int bottom = (uint64_t)(y + 1) * ingest->height
+            / layout->height;
+
+        for (size_t i = 0; i < stride; i++) {
+
+            ingest->sums[i] = 0;
+
+        }
+
+        for (unsigned int row = top; row < bottom; row++) {
+
+            ingest_add_row(ingest, frame + row * stride, stride);
+
+        }
+
+        for (unsigned int x = 0; x < layout->width; x++) {
+
+            unsigned int left = ingest->columns[x];
+            unsigned int right = ingest->columns[x + 1];
+            uint64_t count = (uint64_t)(right - left) * (bottom - top);
+
+            for (int j = 0; j < 3; j++) {
+
+                uint64_t sum = 0;
+
+                for (unsigned int column = left; column < right; column++) {
+
+                    sum += ingest->sums[column * 3 + j];
+
+                }
+
+                *linear++ = (sum + count / 2) / count;
+
+            }
+
+        }
+
+    }
+
+}
+
+/**
+ * Reads the frame of the video to be shown at the given time
+ *
+ * Frames in front of it are skipped, so that the video keeps its speed even
+ * if its frame rate is higher than the one of the pipeline. If it is lower,
+ * the same frame is scaled down again.
+ *
+ * @param ingest Ingestion to read the frame from
+ * @param time Time since the start of the video in microseconds
+ * @param linear Pointer the scaled frame is stored at, see ingest_scale()
+ *
+ * @return Zero on success, -1 at the end of the video (or on failure)
+ */
+int ingest_read(ingest_t* ingest, uint64_t time, uint16_t* linear)
+{
+
+    size_t size = (size_t)ingest->width * ingest->height * 3;
+    unsigned long frame = time * ingest->rate / 1000000;
+
+    while (ingest->frames <= frame) {
+
+        if (fread(ingest->frame, 1, size, ingest->input) != size) {
+
+            return -1;
+
+        }
+
+        ingest->frames++;
+
+    }
+
+    ingest_scale(ingest, ingest->frame, linear);
+
+    return 0;
+
+}
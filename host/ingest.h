@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file ingest.h
+ *
+ * Ingestion of video on the host
+ *
+ * Raw video frames (8 bit RGB, row by row, e.g. as written by
+ * `ffmpeg -f rawvideo -pix_fmt rgb24`) are read from a file or a pipe and
+ * scaled down to the grid of the {@link layout.h layout} by averaging the
+ * area of each pixel in linear light, so the result can be passed to the
+ * {@link pipeline.h pipeline} as a rendered frame.
+ *
+ * @see ingest.c
+ */
+
+#ifndef _LTT_HOST_INGEST_H_
+#define _LTT_HOST_INGEST_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "layout.h"
+
+/**
+ * Ingestion of a single video
+ */
+typedef struct ingest ingest_t;
+
+ingest_t* ingest_open(FILE* input, unsigned int width, unsigned int height,
+    double rate, const layout_t* layout);
+void ingest_close(ingest_t* ingest);
+
+int ingest_read(ingest_t* ingest, uint64_t time, uint16_t* linear);
+void ingest_scale(ingest_t* ingest, const uint8_t* frame, uint16_t* linear);
+
+#endif /* _LTT_HOST_INGEST_H_ */
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file layout.c
+ *
+ * Implements the layout declared in layout.h
+ *
+ * The rows are split up evenly among the segments. Within each segment the
+ * chain runs in a serpentine, i.e. from left to right in the first row, from
+ * right to left in the second one and so on, which is how tables are wired.
+ *
+ * @see layout.h
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include "layout.h"
+#include "protocol.h"
+
+/**
+ * Initializes a layout
+ *
+ * @param layout Layout to initialize
+ * @param width Amount of pixels per row
+ * @param height Amount of rows
+ * @param segments Amount of segments, at most one per row
+ *
+ * @return Zero on success, -1 otherwise (with `errno` set accordingly)
+ */
+int layout_init(layout_t* layout, unsigned int width, unsigned int height,
+    int segments)
+{
+
+    if (!width || segments < 1 || segments > DRIVER_SEGMENTS_MAX
+        || height < (unsigned int)segments) {
+
+        errno = EINVAL;
+
+        return -1;
+
+    }
+
+    layout->width = width;
+    layout->height = height;
+    layout->segments = segments;
+    layout->pixels = calloc((size_t)width * height, sizeof(*layout->pixels));
+
+    for (int i = 0; i < DRIVER_SEGMENTS_MAX; i++) {
+
+        layout->chains[i] = NULL;
+        layout->lengths[i] = 0;
+
+    }
+
+    if (!layout->pixels) {
+
+        return -1;
+
+    }
+
+    unsigned int row = 0;
+
+    for (int i = 0; i < segments; i++) {
+
+        // Spread the remainder over the first segments
+        unsigned int rows = height / segments
+            + ((unsigned int)i < height % segments);
+        unsigned int length = rows * width;
+
+        if (length >= PROTOCOL_ADDRESS_BROADCAST) {
+
+            layout_free(layout);
+            errno = ERANGE;
+
+            return -1;
+
+        }
+
+        layout->chains[i] = malloc(length * sizeof(*layout->chains[i]));
+        layout->lengths[i] = length;
+
+        if (!layout->chains[i]) {
+
+            layout_free(layout);
+
+            return -1;
+
+        }
+
+        for (unsigned int address = 0; address < length; address++) {
+
+            unsigned int y = row + address / width;
+            unsigned int x = address % width;
+
+            if ((address / width) & 1) {
+
+                x = width - 1 - x;
+
+            }
+
+            size_t index = (size_t)y * width + x;
+
+            layout->pixels[index].segment = i;
+            layout->pixels[index].address = address;
+            layout->chains[i][address] = index;
+
+        }
+
+        row += rows;
+
+    }
+
+    return 0;
+
+}
+
+/**
+ * Frees the memory held by a layout
+ *
+ * @param layout Layout to free
+ */
+void layout_free(layout_t* layout)
+{
+
+    for (int i = 0; i < DRIVER_SEGMENTS_MAX; i++) {
+
+        free(layout->chains[i]);
+        layout->chains[i] = NULL;
+
+    }
+
+    free(layout->pixels);
+    layout->pixels = NULL;
+
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file layout.h
+ *
+ * Physical layout of the pixels of a table
+ *
+ * The pixels form a grid, which is rendered row by row. Each pixel of the
+ * grid belongs to a {@link driver.h segment} and has an address within it.
+ * Conversely, each segment is a chain of pixels in the order of their
+ * addresses.
+ *
+ * @see layout.c
+ */
+
+#ifndef _LTT_HOST_LAYOUT_H_
+#define _LTT_HOST_LAYOUT_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "driver.h"
+
+/**
+ * Position of a single pixel on the bus
+ */
+typedef struct {
+
+    /**
+     * @brief Segment the pixel is connected to
+     */
+    uint8_t segment;
+
+    /**
+     * @brief Address of the pixel within its segment
+     */
+    uint8_t address;
+
+} layout_pixel_t;
+
+/**
+ * Layout of the pixels of a table
+ */
+typedef struct {
+
+    /**
+     * @brief Amount of pixels per row
+     */
+    unsigned int width;
+
+    /**
+     * @brief Amount of rows
+     */
+    unsigned int height;
+
+    /**
+     * @brief Amount of segments
+     */
+    int segments;
+
+    /**
+     * @brief Position on the bus of each pixel of the grid, row by row
+     */
+    layout_pixel_t* pixels;
+
+    /**
+     * @brief Index within the grid of each pixel of a segment, by address
+     */
+    size_t* chains[DRIVER_SEGMENTS_MAX];
+
+    /**
+     * @brief Amount of pixels of each segment
+     */
+    unsigned int lengths[DRIVER_SEGMENTS_MAX];
+
+} layout_t;
+
+int layout_init(layout_t* layout, unsigned int width, unsigned int height,
+    int segments);
+void layout_free(layout_t* layout);
+
+#endif /* _LTT_HOST_LAYOUT_H_ */
@@ -0,0 +1,435 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pipeline.c
+ *
+ * Implements the pipeline declared in pipeline.h
+ *
+ * The frames are stored within a ring of slots, which all of the stages
+ * pass through in the same order. Each stage publishes the amount of frames
+ * it is done with in a counter of its own, which only it writes to. A stage
+ * waits for the counter of the stage in front of it (and the render stage
+ * for the transmit stage to release a slot), so frames are handed off
+ * without any locks.
+ *
+ * The render stage runs within the calling thread, the other stages are
+ * started and stopped by pipeline_run().
+ *
+ * @see pipeline.h
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "pipeline.h"
+
+/**
+ * @brief Amount of times a stage yields before it starts to sleep
+ */
+#define PIPELINE_SPIN 64
+
+/**
+ * @brief Time a waiting stage sleeps for in nanoseconds
+ */
+#define PIPELINE_SLEEP 100000
+
+/**
+ * A single frame in flight
+ */
+typedef struct {
+
+    /**
+     * @brief Rendered frame
+     */
+    uint16_t* linear;
+
+    /**
+     * @brief Quantized colors
+     */
+    color_rgb_t* colors;
+
+    /**
+     * @brief Encoded bytes of each segment
+     */
+    uint8_t* encoded[DRIVER_SEGMENTS_MAX];
+
+    /**
+     * @brief Buffers handed to the driver
+     */
+    driver_buffer_t buffers[DRIVER_SEGMENTS_MAX];
+
+} pipeline_slot_t;
+
+/**
+ * State shared by all stages
+ */
+typedef struct {
+
+    /**
+     * @brief Layout of the pixels
+     */
+    const layout_t* layout;
+
+    /**
+     * @brief Encoder used by the encode stage
+     */
+    encoder_t* encoder;
+
+    /**
+     * @brief Driver used by the transmit stage
+     */
+    driver_t* driver;
+
+    /**
+     * @brief Number the driver knows the first frame by
+     */
+    unsigned long base;
+
+    /**
+     * @brief Frames in flight
+     */
+    pipeline_slot_t slots[PIPELINE_SLOTS];
+
+    /**
+     * @brief Amount of frames rendered
+     */
+    unsigned long rendered;
+
+    /**
+     * @brief Amount of frames encoded
+     */
+    unsigned long encoded;
+
+    /**
+     * @brief Amount of frames transmitted completely
+     */
+    unsigned long released;
+
+    /**
+     * @brief Amount of frames in total, ULONG_MAX while still rendering
+     */
+    unsigned long end;
+
+    /**
+     * @brief Time spent on encoding in microseconds
+     */
+    uint64_t encode;
+
+} pipeline_t;
+
+/**
+ * Returns the current time
+ *
+ * @return Time in microseconds
+ */
+static uint64_t pipeline_now()
+{
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+}
+
+/**
+ * Waits for a counter of another stage to exceed the given frame
+ *
+ * @param pipeline Pipeline the counter belongs to
+ * @param counter Counter to wait for
+ * @param frame Frame the counter needs to exceed
+ *
+ * @return Zero once the counter exceeds the frame, -1 if there is no such
+ * frame, as the render stage has finished
+ */
+static int pipeline_wait(pipeline_t* pipeline, unsigned long* counter,
+    unsigned long frame)
+{
+
+    for (unsigned int i = 0; ; i++) {
+
+        if (__atomic_load_n(counter, __ATOMIC_ACQUIRE) > frame) {
+
+            return 0;
+
+        }
+
+        if (__atomic_load_n(&pipeline->end, __ATOMIC_ACQUIRE) <= frame) {
+
+            return -1;
+
+        }
+
+        if (i < PIPELINE_SPIN) {
+
+            sched_yield();
+
+        } else {
+
+            struct timespec ts = {0, PIPELINE_SLEEP};
+
+            nanosleep(&ts, NULL);
+
+        }
+
+    }
+
+}
+
+/**
+ * Encodes the rendered frames
+ *
+ * @param arg Pipeline to encode the frames of
+ *
+ * @return NULL
+ */
+static void* pipeline_encode(void* arg)
+{
+
+    pipeline_t* pipeline = arg;
+    const layout_t* layout = pipeline->layout;
+
+    for (unsigned long frame = 0;
+        !pipeline_wait(pipeline, &pipeline->rendered, frame); frame++) {
+
+        pipeline_slot_t* slot = &pipeline->slots[frame % PIPELINE_SLOTS];
+        uint64_t start = pipeline_now();
+        uint16_t latch = driver_latch(pipeline->driver, pipeline->base + frame);
+
+        encoder_quantize(pipeline->encoder, slot->linear, slot->colors);
+
+        for (int i = 0; i < layout->segments; i++) {
+
+            slot->buffers[i].data = slot->encoded[i];
+            slot->buffers[i].size = encoder_encode(pipeline->encoder, i,
+                slot->colors, latch, slot->encoded[i]);
+
+        }
+
+        pipeline->encode += pipeline_now() - start;
+
+        __atomic_store_n(&pipeline->encoded, frame + 1, __ATOMIC_RELEASE);
+
+    }
+
+    return NULL;
+
+}
+
+/**
+ * Transmits the encoded frames
+ *
+ * @param arg Pipeline to transmit the frames of
+ *
+ * @return NULL
+ */
+static void* pipeline_transmit(void* arg)
+{
+
+    pipeline_t* pipeline = arg;
+
+    for (unsigned long frame = 0;
+        !pipeline_wait(pipeline, &pipeline->encoded, frame); frame++) {
+
+        pipeline_slot_t* slot = &pipeline->slots[frame % PIPELINE_SLOTS];
+
+        // Waits for the previous frame to be transmitted
+        driver_begin(pipeline->driver);
+
+        __atomic_store_n(&pipeline->released, frame, __ATOMIC_RELEASE);
+
+        driver_transmit(pipeline->driver, slot->buffers);
+
+    }
+
+    // The buffers of the last frame are freed once this returns
+    driver_flush(pipeline->driver);
+
+    return NULL;
+
+}
+
+/**
+ * Frees the buffers of all slots
+ *
+ * @param pipeline Pipeline to free the slots of
+ */
+static void pipeline_free(pipeline_t* pipeline)
+{
+
+    for (int i = 0; i < PIPELINE_SLOTS; i++) {
+
+        pipeline_slot_t* slot = &pipeline->slots[i];
+
+        free(slot->linear);
+        free(slot->colors);
+
+        for (int j = 0; j < DRIVER_SEGMENTS_MAX; j++) {
+
+            free(slot->encoded[j]);
+
+        }
+
+    }
+
+}
+
+/**
+ * Runs frames through the pipeline until the render callback runs out of
+ * frames
+ *
+ * The render callback is invoked from within the calling thread. This
+ * returns once all of the frames rendered have been transmitted.
+ *
+ * @param layout Layout of the pixels
+ * @param encoder Encoder to use
+ * @param driver Driver to transmit the frames with
+ * @param render Callback rendering the frames
+ * @param context Context passed to the callback
+ * @param stats Pointer the statistics are stored at, may be NULL
+ *
+ * @return Zero on success, -1 otherwise (with `errno` set accordingly)
+ */
+int pipeline_run(const layout_t* layout, encoder_t* encoder,
+    driver_t* driver, pipeline_render_t render, void* context,
+    pipeline_stats_t* stats)
+{
+
+    size_t pixels = (size_t)layout->width * layout->height;
+    pipeline_t* pipeline = calloc(1, sizeof(*pipeline));
+    driver_stats_t driver_stats;
+
+    if (!pipeline) {
+
+        return -1;
+
+    }
+
+    driver_get_stats(driver, &driver_stats);
+
+    pipeline->layout = layout;
+    pipeline->encoder = encoder;
+    pipeline->driver = driver;
+    pipeline->base = driver_stats.frames;
+    pipeline->end = ULONG_MAX;
+
+    for (int i = 0; i < PIPELINE_SLOTS; i++) {
+
+        pipeline_slot_t* slot = &pipeline->slots[i];
+        int failed = 0;
+
+        slot->linear = malloc(pixels * 3 * sizeof(*slot->linear));
+        slot->colors = malloc(pixels * sizeof(*slot->colors));
+        failed = !slot->linear || !slot->colors;
+
+        for (int j = 0; j < layout->segments; j++) {
+
+            slot->encoded[j] = malloc(layout->lengths[j] * ENCODER_FRAME_SIZE);
+            failed |= !slot->encoded[j];
+
+        }
+
+        if (failed) {
+
+            pipeline_free(pipeline);
+            free(pipeline);
+            errno = ENOMEM;
+
+            return -1;
+
+        }
+
+    }
+
+    pthread_t encode;
+    pthread_t transmit;
+
+    if (pthread_create(&encode, NULL, pipeline_encode, pipeline)) {
+
+        pipeline_free(pipeline);
+        free(pipeline);
+
+        return -1;
+
+    }
+
+    if (pthread_create(&transmit, NULL, pipeline_transmit, pipeline)) {
+
+        __atomic_store_n(&pipeline->end, 0, __ATOMIC_RELEASE);
+        pthread_join(encode, NULL);
+        pipeline_free(pipeline);
+        free(pipeline);
+
+        return -1;
+
+    }
+
+    uint64_t time = 0;
+    unsigned long frame;
+
+    for (frame = 0; ; frame++) {
+
+        // Wait for the slot to be released by the transmit stage
+        if (frame >= PIPELINE_SLOTS) {
+
+            pipeline_wait(pipeline, &pipeline->released,
+                frame - PIPELINE_SLOTS);
+
+        }
+
+        pipeline_slot_t* slot = &pipeline->slots[frame % PIPELINE_SLOTS];
+        uint64_t start = pipeline_now();
+
+        if (render(context, frame, slot->linear)) {
+
+            break;
+
+        }
+
+        time += pipeline_now() - start;
+
+        __atomic_store_n(&pipeline->rendered, frame + 1, __ATOMIC_RELEASE);
+
+    }
+
+    __atomic_store_n(&pipeline->end, frame, __ATOMIC_RELEASE);
+
+    pthread_join(encode, NULL);
+    pthread_join(transmit, NULL);
+
+    if (stats) {
+
+        stats->frames = frame;
+        stats->render = time;
+        stats->encode = pipeline->encode;
+
+    }
+
+    pipeline_free(pipeline);
+    free(pipeline);
+
+    return 0;
+
+}
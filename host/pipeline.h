@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pipeline.h
+ *
+ * Pipeline rendering, encoding and transmitting frames on the host
+ *
+ * Frames pass through three stages, each running in a thread of its own:
+ *
+ * - The render stage produces a frame in linear light.
+ * - The encode stage {@link encoder.h quantizes and encodes} it for each
+ *   segment, queueing the colors for its latch time.
+ * - The transmit stage hands the encoded frame to the
+ *   {@link driver.h driver}, whose writer threads transmit it on all
+ *   segments at once.
+ *
+ * There are {@link #PIPELINE_SLOTS} frames in flight, so all of the stages
+ * work on different frames at the same time. This way the frame rate is
+ * only bound by the slowest stage, which usually is the bus.
+ *
+ * @see pipeline.c
+ */
+
+#ifndef _LTT_HOST_PIPELINE_H_
+#define _LTT_HOST_PIPELINE_H_
+
+#include <inttypes.h>
+
+#include "driver.h"
+#include "encoder.h"
+#include "layout.h"
+
+/**
+ * @brief Amount of frames in flight
+ */
+#define PIPELINE_SLOTS 3
+
+/**
+ * Callback rendering a single frame
+ *
+ * @param context Context given to pipeline_run()
+ * @param frame Number of the frame, starting with zero
+ * @param linear Buffer the frame is rendered into, with the red, green and
+ * blue channel of each pixel of the grid, row by row
+ *
+ * @return Zero on success, non-zero value if there are no more frames
+ */
+typedef int (*pipeline_render_t)(void* context, unsigned long frame,
+    uint16_t* linear);
+
+/**
+ * Statistics of a pipeline
+ */
+typedef struct {
+
+    /**
+     * @brief Frames passed through the pipeline
+     */
+    unsigned long frames;
+
+    /**
+     * @brief Time spent on rendering in microseconds
+     */
+    uint64_t render;
+
+    /**
+     * @brief Time spent on encoding in microseconds
+     */
+    uint64_t encode;
+
+} pipeline_stats_t;
+
+int pipeline_run(const layout_t* layout, encoder_t* encoder,
+    driver_t* driver, pipeline_render_t render, void* context,
+    pipeline_stats_t* stats);
+
+#endif /* _LTT_HOST_PIPELINE_H_ */
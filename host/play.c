@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file play.c
+ *
+ * Tool playing a video on a table
+ *
+ * \code
+ *  play -s WIDTHxHEIGHT [-r RATE] [-g COLUMNSxROWS] [-p PERIOD] [-d DITHER]
+ *      [-i FILE] {DEVICE... | -t SEGMENTS}
+ * \endcode
+ *
+ * The raw video (see ingest.h) of the given size and frame rate (25 frames
+ * per second by default) is read from the given file or the standard input
+ * and played on a grid of the given size (16x16 by default) split up among
+ * the segments, with the given frame period (20000 microseconds by default)
+ * and {@link encoder_set_dither() dithering} (none by default). `-t`
+ * creates pseudo terminals instead, just like the drive tool does. This can
+ * be used to play videos as they are converted, e.g.:
+ *
+ * \code
+ *  ffmpeg -i video.mp4 -f rawvideo -pix_fmt rgb24 - \
+ *      | ./play -s 1920x1080 -r 60 /dev/ttyUSB0 /dev/ttyUSB1
+ * \endcode
+ *
+ * The time spent on ingesting each frame is written to the standard error
+ * output at the end, along with the other statistics.
+ *
+ * It can be built with:
+ *
+ * \code
+ *  cc -std=gnu99 -O2 -pthread -I../src -o play play.c driver.c encoder.c \
+ *      frame.c ingest.c layout.c pipeline.c pty.c ../src/crc.c ../src/fec.c \
+ *      -lm
+ * \endcode
+ *
+ * @see ingest.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "driver.h"
+#include "encoder.h"
+#include "ingest.h"
+#include "layout.h"
+#include "pipeline.h"
+#include "pty.h"
+
+/**
+ * Video being played
+ */
+typedef struct {
+
+    /**
+     * @brief Ingestion of the video
+     */
+    ingest_t* ingest;
+
+    /**
+     * @brief Frame period in microseconds
+     */
+    unsigned long period;
+
+} play_video_t;
+
+/**
+ * Parses a size given as `WIDTHxHEIGHT`
+ *
+ * @param arg Argument to parse
+ * @param width Pointer the width is stored at
+ * @param height Pointer the height is stored at
+ *
+ * @return Zero on success, -1 otherwise
+ */
+static int play_parse_size(const char* arg, unsigned int* width,
+    unsigned int* height)
+{
+
+    char* end;
+
+    *width = strtoul(arg, &end, 10);
+
+    if (*end != 'x') {
+
+        return -1;
+
+    }
+
+    *height = strtoul(end + 1, &end, 10);
+
+    return (*end != '\0' || !*width || !*height) ? -1 : 0;
+
+}
+
+/**
+ * Renders a single frame of the video
+ *
+ * @param context Video being played
+ * @param frame Number of the frame
+ * @param linear Buffer the frame is rendered into
+ *
+ * @return Zero on success, non-zero value at the end of the video
+ */
+static int play_render(void* context, unsigned long frame, uint16_t* linear)
+{
+
+    play_video_t* video = context;
+
+    return ingest_read(video->ingest, (uint64_t)frame * video->period,
+        linear);
+
+}
+
+int main(int argc, char* argv[])
+{
+
+    unsigned int width = 0;
+    unsigned int height = 0;
+    unsigned int columns = 16;
+    unsigned int rows = 16;
+    double rate = 25;
+    unsigned long period = 20000;
+    unsigned long ptys = 0;
+    int dither = ENCODER_DITHER_NONE;
+    FILE* input = stdin;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:r:g:p:d:i:t:")) != -1) {
+
+        switch (opt) {
+
+            case 's':
+                if (play_parse_size(optarg, &width, &height)) {
+                    goto usage;
+                }
+                break;
+
+            case 'r':
+                rate = strtod(optarg, NULL);
+                break;
+
+            case 'g':
+                if (play_parse_size(optarg, &columns, &rows)) {
+                    goto usage;
+                }
+                break;
+
+            case 'p':
+                period = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'd':
+                dither = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'i':
+                input = fopen(optarg, "rb");
+                if (!input) {
+                    perror(optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 't':
+                ptys = strtoul(optarg, NULL, 0);
+                break;
+
+            default:
+                goto usage;
+
+        }
+
+    }
+
+    const char* devices[DRIVER_SEGMENTS_MAX];
+    int segments = ptys ? (int)ptys : argc - optind;
+
+    if (!width || !period || segments < 1 || segments > DRIVER_SEGMENTS_MAX
+        || (ptys && optind != argc)) {
+
+        goto usage;
+
+    }
+
+    for (int i = 0; i < segments; i++) {
+
+        devices[i] = ptys ? pty_open() : argv[optind + i];
+
+        if (!devices[i]) {
+
+            perror("pty");
+
+            return EXIT_FAILURE;
+
+        }
+
+    }
+
+    layout_t layout;
+
+    if (layout_init(&layout, columns, rows, segments)) {
+
+        perror("layout");
+
+        return EXIT_FAILURE;
+
+    }
+
+    play_video_t video = {
+
+        .ingest = ingest_open(input, width, height, rate, &layout),
+        .period = period,
+
+    };
+
+    if (!video.ingest) {
+
+        fprintf(stderr, "video is too small for the grid\n");
+
+        return EXIT_FAILURE;
+
+    }
+
+    unsigned int pixels = 0;
+
+    for (int i = 0; i < segments; i++) {
+
+        if (layout.lengths[i] > pixels) {
+
+            pixels = layout.lengths[i];
+
+        }
+
+    }
+
+    // The frame clock starts with the driver, so it is opened last
+    encoder_t* encoder = encoder_create(&layout);
+
+    if (encoder) {
+
+        encoder_set_dither(encoder, dither);
+
+    }
+
+    driver_t* driver = encoder ? driver_open(devices, segments, period, pixels)
+        : NULL;
+
+    if (!driver) {
+
+        perror("driver");
+
+        return EXIT_FAILURE;
+
+    }
+
+    pipeline_stats_t pipeline_stats;
+
+    if (pipeline_run(&layout, encoder, driver, play_render, &video,
+        &pipeline_stats)) {
+
+        perror("pipeline");
+
+        return EXIT_FAILURE;
+
+    }
+
+    driver_stats_t stats;
+    driver_get_stats(driver, &stats);
+    driver_close(driver);
+    encoder_destroy(encoder);
+    ingest_close(video.ingest);
+    layout_free(&layout);
+
+    for (int i = 0; ptys && i < segments; i++) {
+
+        free((char*)devices[i]);
+
+    }
+
+    fprintf(stderr, "%lu frames, %lu late, %llu bytes, %lu errors\n",
+        stats.frames, stats.late, stats.bytes, stats.errors);
+
+    if (pipeline_stats.frames) {
+
+        fprintf(stderr, "%.1f us ingesting, %.1f us encoding per frame\n",
+            (double)pipeline_stats.render / pipeline_stats.frames,
+            (double)pipeline_stats.encode / pipeline_stats.frames);
+
+    }
+
+    return (stats.errors) ? EXIT_FAILURE : EXIT_SUCCESS;
+
+usage:
+
+    fprintf(stderr, "usage: %s -s WIDTHxHEIGHT [-r RATE] [-g COLUMNSxROWS] "
+        "[-p PERIOD] [-d DITHER] [-i FILE] {DEVICE... | -t SEGMENTS}\n",
+        argv[0]);
+
+    return EXIT_FAILURE;
+
+}
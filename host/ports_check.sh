@@ -0,0 +1,125 @@
+#!/bin/sh
+#
+# Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+#
+# This file is part of LEDTouchTable.
+#
+# LEDTouchTable is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# LEDTouchTable is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+#
+# Checks that the macros of ports.h compile down to single instructions
+#
+#   ./ports_check.sh [MCU...]
+#
+# ports_probe.c is built with avr-gcc -Os for each of the given
+# microcontrollers (all of the supported ones by default) and disassembled
+# with avr-objdump. Each probe function must consist of exactly one `sbi`
+# (SET_OUTPUT, SET_HIGH, TOGGLE), `cbi` (SET_INPUT, SET_LOW) or `sbic`/`sbis`
+# (IS_HIGH) instruction, apart from `ret`, `nop` and `rjmp`. Anything else,
+# e.g. `in`/`out` or `lds`/`sts`, means the address of a register didn't
+# fold into a constant within the lower I/O space.
+#
+# The exit status is non-zero if any of the probes fails.
+#
+
+set -e
+
+cd "$(dirname "$0")"
+
+CC=${CC:-avr-gcc}
+OBJDUMP=${OBJDUMP:-avr-objdump}
+
+object=$(mktemp)
+trap 'rm -f "$object"' EXIT
+
+status=0
+
+for mcu in ${@:-attiny841 atmega1284p}; do
+
+    "$CC" -std=gnu99 -Os -mmcu="$mcu" -DF_CPU=8000000UL -I../src \
+        -c ports_probe.c -o "$object"
+
+    "$OBJDUMP" -d "$object" | awk -F '\t' -v mcu="$mcu" '
+
+        function check() {
+
+            if (name == "") {
+                return
+            }
+
+            expected = "sbi"
+
+            if (name ~ /^ports_probe_(set_input|set_low)_/) {
+                expected = "cbi"
+            } else if (name ~ /^ports_probe_is_high_/) {
+                expected = "sbic|sbis"
+            }
+
+            if (count != 1 || instructions !~ "^ (" expected ")$") {
+                printf("%s: %s:%s\n", mcu, name, instructions)
+                failed = 1
+            }
+
+            probes++
+
+        }
+
+        /^[0-9a-f]+ <.*>:$/ {
+
+            check()
+
+            name = $0
+            sub(/^[^<]*</, "", name)
+            sub(/>:$/, "", name)
+
+            if (name !~ /^ports_probe_/) {
+                name = ""
+            }
+
+            count = 0
+            instructions = ""
+
+            next
+
+        }
+
+        name != "" && NF >= 3 {
+
+            mnemonic = $3
+            gsub(/ /, "", mnemonic)
+
+            if (mnemonic !~ /^(ret|nop|rjmp)$/) {
+                count++
+                instructions = instructions " " mnemonic
+            }
+
+        }
+
+        END {
+
+            check()
+
+            if (!probes) {
+                printf("%s: no probes found\n", mcu)
+                failed = 1
+            }
+
+            exit failed
+
+        }
+
+    ' || status=1
+
+done
+
+exit $status
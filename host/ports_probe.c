@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file ports_probe.c
+ *
+ * Probe for the code generated by the macros of ports.h
+ *
+ * Each function applies a single macro to one of the pins of the board, so
+ * that the instructions it compiles down to can be checked in the
+ * disassembly. This is done by ports_check.sh, which expects each function
+ * to consist of a single `sbi`, `cbi`, `sbic` or `sbis` instruction (besides
+ * the `ret` and the `nop` marking the conditional code).
+ *
+ * The pins cover each of the ports used by the board. They are only
+ * accessible by these instructions if the addresses of the `DDRx` and `PINx`
+ * registers, which are derived from the address of the `PORTx` register,
+ * fold into constants within the lower I/O space.
+ *
+ * It isn't linked into the firmware, but built on its own with e.g.:
+ *
+ * \code
+ *  avr-gcc -std=gnu99 -Os -mmcu=attiny841 -I../src -c ports_probe.c
+ * \endcode
+ *
+ * @see ports_check.sh
+ */
+
+#include <avr/io.h>
+
+#include "pins.h"
+#include "ports.h"
+
+/**
+ * @brief Defines the probe functions for a single pin
+ *
+ * The functions are named after the macro they apply, followed by the given
+ * name, e.g. `ports_probe_set_high_bus_rx()`.
+ */
+#define PORTS_PROBE(name, pin) \
+    void ports_probe_set_output_##name() { SET_OUTPUT(pin); } \
+    void ports_probe_set_input_##name() { SET_INPUT(pin); } \
+    void ports_probe_set_high_##name() { SET_HIGH(pin); } \
+    void ports_probe_set_low_##name() { SET_LOW(pin); } \
+    void ports_probe_toggle_##name() { TOGGLE(pin); } \
+    void ports_probe_is_high_##name() \
+    { \
+        if (IS_HIGH(pin)) { \
+            __asm__ volatile ("nop"); \
+        } \
+    }
+
+PORTS_PROBE(bus_rx, PIN_BUS_RX)
+PORTS_PROBE(ir_sensor, PIN_IR_SENSOR)
+PORTS_PROBE(ir_emitter, PIN_IR_EMITTER)
+PORTS_PROBE(led_red, PIN_LED_RED)
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pty.c
+ *
+ * Implements the pseudo terminals declared in pty.h
+ *
+ * @see pty.h
+ */
+
+#define _XOPEN_SOURCE 600
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pty.h"
+
+/**
+ * Reads and discards everything written to a pseudo terminal
+ *
+ * @param arg File descriptor of the master side
+ *
+ * @return NULL
+ */
+static void* pty_drain(void* arg)
+{
+
+    int fd = (intptr_t)arg;
+    uint8_t buffer[256];
+
+    while (read(fd, buffer, sizeof(buffer)) > 0);
+
+    return NULL;
+
+}
+
+/**
+ * Creates a pseudo terminal drained by a thread of its own
+ *
+ * The pseudo terminal and its thread stay around until the process exits.
+ *
+ * @return Path of the pseudo terminal, which needs to be freed by the caller,
+ * or NULL on failure
+ */
+char* pty_open()
+{
+
+    pthread_t thread;
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (fd < 0) {
+
+        return NULL;
+
+    }
+
+    // The name is overwritten by subsequent calls
+    char* path = (grantpt(fd) || unlockpt(fd)) ? NULL : strdup(ptsname(fd));
+
+    if (!path
+        || pthread_create(&thread, NULL, pty_drain, (void*)(intptr_t)fd)) {
+
+        free(path);
+        close(fd);
+
+        return NULL;
+
+    }
+
+    return path;
+
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pty.h
+ *
+ * Pseudo terminals standing in for serial ports
+ *
+ * The tools driving the bus can be run without any hardware by handing
+ * pseudo terminals to the {@link driver.h driver} instead of serial ports.
+ * Everything written to them is read and discarded by a thread of their own,
+ * so the driver never blocks on them for longer than it would on the bus.
+ *
+ * @see pty.c
+ */
+
+#ifndef _LTT_HOST_PTY_H_
+#define _LTT_HOST_PTY_H_
+
+char* pty_open();
+
+#endif /* _LTT_HOST_PTY_H_ */
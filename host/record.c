@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file record.c
+ *
+ * Tool recording the traffic on the bus into a {@link capture.h capture}
+ *
+ * \code
+ *  record DEVICE...
+ * \endcode
+ *
+ * Each device is a serial port listening to a single bus segment, which
+ * becomes the segment with the same index within the capture (starting with
+ * zero). The devices need to be configured beforehand, e.g.:
+ *
+ * \code
+ *  stty -F /dev/ttyUSB0 250000 raw
+ * \endcode
+ *
+ * The capture is written to the standard output until the tool is
+ * interrupted. Serial ports usually deliver received bytes in chunks, so
+ * only the last byte of each chunk is timed precisely. The bytes in front of
+ * it are assumed to have been transferred back to back.
+ *
+ * It can be built with:
+ *
+ * \code
+ *  cc -std=gnu99 -I../src -o record record.c capture.c
+ * \endcode
+ *
+ * @see capture.h
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bus.h"
+#include "capture.h"
+
+/**
+ * @brief Maximum amount of devices recorded at once
+ */
+#define RECORD_DEVICES_MAX 16
+
+/**
+ * Whether the tool has been interrupted
+ */
+static volatile sig_atomic_t record_interrupted = 0;
+
+/**
+ * Takes note that the tool has been interrupted
+ *
+ * @param signal Signal received
+ */
+static void record_interrupt(int signal)
+{
+
+    record_interrupted = 1;
+
+}
+
+/**
+ * Returns the current time
+ *
+ * @return Time in microseconds
+ */
+static uint64_t record_now()
+{
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+}
+
+int main(int argc, char* argv[])
+{
+
+    struct pollfd fds[RECORD_DEVICES_MAX];
+    uint64_t last[RECORD_DEVICES_MAX];
+    int devices = argc - 1;
+
+    if (devices < 1 || devices > RECORD_DEVICES_MAX) {
+
+        fprintf(stderr, "usage: %s DEVICE...\n", argv[0]);
+
+        return EXIT_FAILURE;
+
+    }
+
+    for (int i = 0; i < devices; i++) {
+
+        fds[i].fd = open(argv[i + 1], O_RDONLY | O_NOCTTY);
+        fds[i].events = POLLIN;
+        last[i] = 0;
+
+        if (fds[i].fd < 0) {
+
+            perror(argv[i + 1]);
+
+            return EXIT_FAILURE;
+
+        }
+
+    }
+
+    struct sigaction action = {
+
+        .sa_handler = record_interrupt,
+
+    };
+
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    if (capture_write_header(stdout)) {
+
+        perror("stdout");
+
+        return EXIT_FAILURE;
+
+    }
+
+    uint64_t start = record_now();
+    int open_devices = devices;
+
+    while (!record_interrupted && open_devices) {
+
+        if (poll(fds, devices, -1) < 0) {
+
+            if (errno == EINTR) {
+
+                continue;
+
+            }
+
+            perror("poll");
+
+            return EXIT_FAILURE;
+
+        }
+
+        uint64_t now = record_now() - start;
+
+        for (int i = 0; i < devices; i++) {
+
+            if (!(fds[i].revents & POLLIN)) {
+
+                continue;
+
+            }
+
+            uint8_t buffer[256];
+            ssize_t size = read(fds[i].fd, buffer, sizeof(buffer));
+
+            if (size <= 0) {
+
+                fds[i].fd = -1;
+                open_devices--;
+
+                continue;
+
+            }
+
+            for (ssize_t j = 0; j < size; j++) {
+
+                capture_record_t record = {
+
+                    .time = now - (size - 1 - j) * BUS_BYTE_TIME,
+                    .segment = i,
+                    .byte = buffer[j],
+
+                };
+
+                // Keep the records of each segment ordered
+                if (now < (size - 1 - j) * BUS_BYTE_TIME
+                    || record.time < last[i]) {
+
+                    record.time = last[i];
+
+                }
+
+                last[i] = record.time;
+
+                if (capture_write(stdout, &record)) {
+
+                    perror("stdout");
+
+                    return EXIT_FAILURE;
+
+                }
+
+            }
+
+        }
+
+    }
+
+    fflush(stdout);
+
+    return EXIT_SUCCESS;
+
+}
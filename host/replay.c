@@ -0,0 +1,624 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file replay.c
+ *
+ * Tool replaying a {@link capture.h capture} against simulated pixels
+ *
+ * \code
+ *  replay [-n PIXELS] [-s SEGMENT] [-u] [-x PIXEL] [CAPTURE]
+ * \endcode
+ *
+ * The bytes of a single segment of the capture (read from the given file or
+ * the standard input) are fed into a chain of {@link sim.h simulated pixels}
+ * with the time they have been recorded at. Each pixel forwards bytes to the
+ * next one the same way it does on the bus, i.e. delayed by
+ * {@link #BUS_HOP_DELAY} and no faster than {@link #BUS_BYTE_TIME}, so that
+ * the replay reflects the throughput of the chain.
+ *
+ * As the parser keeps its state in static variables, each pixel runs within
+ * a process of its own, connected to its neighbours by pipes carrying
+ * captures themselves. The replay is nevertheless deterministic, as each
+ * pixel only depends on the bytes it receives.
+ *
+ * The colors applied by the pixels are written to the standard output, one
+ * per line, ordered by time:
+ *
+ * \code
+ *  TIME PIXEL LED RED GREEN BLUE WHITE
+ * \endcode
+ *
+ * `TIME` is given in microseconds, `LED` is the index of the LED within the
+ * cluster of the pixel. A summary for each pixel follows as comments, which
+ * includes the position the pixel ended up with. By default the pixels know
+ * their position within the chain, `-u` lets them start without one instead.
+ *
+ * `-x` simulates a dead pixel at the given position, which is bypassed by the
+ * pixel following it: That one receives the bytes forwarded by the pixel in
+ * front of the dead one, with its {@link #BUS_LINK_BYPASSED link bypassed}.
+ *
+ * It can be built with:
+ *
+ * \code
+ *  cc -std=gnu99 -I../src -o replay replay.c capture.c sim.c ../src/protocol.c \
+ *      ../src/crc.c ../src/fec.c
+ * \endcode
+ *
+ * @see capture.h
+ * @see sim.h
+ */
+
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bus.h"
+#include "capture.h"
+#include "protocol.h"
+#include "sim.h"
+
+/**
+ * @brief Maximum amount of pixels within the chain
+ *
+ * Hop counters don't count beyond this, anyway.
+ */
+#define REPLAY_PIXELS_MAX UINT8_MAX
+
+/**
+ * Color applied by a pixel
+ */
+typedef struct {
+
+    /**
+     * @brief Time the color has been applied at in microseconds
+     */
+    uint64_t time;
+
+    /**
+     * @brief Sequence number of the color within the pixel
+     */
+    unsigned long sequence;
+
+    /**
+     * @brief Position of the pixel within the chain
+     */
+    uint8_t pixel;
+
+    /**
+     * @brief Index of the LED within the cluster of the pixel
+     */
+    uint8_t index;
+
+    /**
+     * @brief Color applied
+     */
+    color_rgbw_t color;
+
+} replay_event_t;
+
+/**
+ * Summary of the replay for a single pixel
+ */
+typedef struct {
+
+    /**
+     * @brief Bytes received
+     */
+    unsigned long received;
+
+    /**
+     * @brief Frames received with a valid CRC
+     */
+    unsigned long frames;
+
+    /**
+     * @brief Colors applied
+     */
+    unsigned long colors;
+
+    /**
+     * @brief Time the last byte has been received at in microseconds
+     */
+    uint64_t last;
+
+    /**
+     * @brief Position of the pixel at the end of the replay
+     */
+    uint8_t address;
+
+} replay_summary_t;
+
+/**
+ * Position of the pixel simulated by this process
+ */
+static uint8_t replay_pixel;
+
+/**
+ * Time of the byte currently being processed
+ */
+static uint64_t replay_time;
+
+/**
+ * Time the last byte has been forwarded at, zero if none has been yet
+ */
+static uint64_t replay_sent = 0;
+
+/**
+ * Segment being replayed
+ */
+static uint8_t replay_segment = 0;
+
+/**
+ * Capture the forwarded bytes are written to, NULL for the last pixel
+ */
+static FILE* replay_out;
+
+/**
+ * File the applied colors are written to
+ */
+static FILE* replay_report;
+
+/**
+ * Amount of colors applied so far
+ */
+static unsigned long replay_colors = 0;
+
+/**
+ * Forwards a byte to the next pixel
+ *
+ * @param byte Byte to forward
+ */
+static void replay_send(uint8_t byte)
+{
+
+    uint64_t time = replay_time + BUS_HOP_DELAY;
+
+    // Bytes can't be sent any faster than the bus allows
+    if (replay_sent && time < replay_sent + BUS_BYTE_TIME) {
+
+        time = replay_sent + BUS_BYTE_TIME;
+
+    }
+
+    replay_sent = time;
+
+    if (replay_out) {
+
+        capture_record_t record = {
+
+            .time = time,
+            .segment = replay_segment,
+            .byte = byte,
+
+        };
+
+        if (capture_write(replay_out, &record)) {
+
+            perror("pipe");
+            _exit(EXIT_FAILURE);
+
+        }
+
+    }
+
+}
+
+/**
+ * Reports a color applied by the pixel
+ *
+ * @param time Time the color has been applied at
+ * @param index Index of the LED within the cluster
+ * @param color Color applied
+ */
+static void replay_color(uint64_t time, uint8_t index,
+    const color_rgbw_t* color)
+{
+
+    replay_event_t event = {
+
+        .time = time,
+        .sequence = replay_colors++,
+        .pixel = replay_pixel,
+        .index = index,
+        .color = *color,
+
+    };
+
+    if (fwrite(&event, sizeof(event), 1, replay_report) != 1) {
+
+        perror("report");
+        _exit(EXIT_FAILURE);
+
+    }
+
+}
+
+/**
+ * Simulates a single pixel until its input ends
+ *
+ * @param in File descriptor of the capture received
+ * @param out File descriptor the forwarded bytes are written to, -1 if none
+ * @param addressed Whether the pixel knows its position
+ * @param bypassed Whether the pixel in front of this one is dead
+ * @param summary Pointer the summary is stored at
+ */
+static void replay_run(int in, int out, int addressed, int bypassed,
+    replay_summary_t* summary)
+{
+
+    FILE* input = fdopen(in, "rb");
+    capture_record_t record;
+    int result;
+
+    replay_out = (out < 0) ? NULL : fdopen(out, "wb");
+
+    if (!input || (out >= 0 && !replay_out)
+        || capture_read_header(input)
+        || (replay_out && capture_write_header(replay_out))) {
+
+        perror("pipe");
+        _exit(EXIT_FAILURE);
+
+    }
+
+    if (addressed) {
+
+        protocol_set_address(replay_pixel);
+
+    }
+
+    sim_set_send(replay_send);
+    sim_set_color(replay_color);
+    sim_set_link_state(bypassed ? BUS_LINK_BYPASSED : 0);
+
+    summary->received = 0;
+
+    while ((result = capture_read(input, &record)) > 0) {
+
+        replay_time = record.time;
+        sim_set_time(record.time);
+        protocol_process(record.byte);
+
+        summary->received++;
+        summary->last = record.time;
+
+    }
+
+    sim_counters_t counters;
+    sim_get_counters(&counters);
+
+    summary->frames = counters.frames;
+    summary->colors = replay_colors;
+    summary->address = protocol_get_address();
+
+    if (result < 0 || fflush(replay_report)
+        || (replay_out && fclose(replay_out))) {
+
+        perror("pipe");
+        _exit(EXIT_FAILURE);
+
+    }
+
+    _exit(EXIT_SUCCESS);
+
+}
+
+/**
+ * Compares two colors applied by their time, pixel and sequence
+ *
+ * @param a First color
+ * @param b Second color
+ *
+ * @return Negative, zero or positive value if the first color is applied
+ * before, at the same time or after the second one
+ */
+static int replay_compare(const void* a, const void* b)
+{
+
+    const replay_event_t* x = a;
+    const replay_event_t* y = b;
+
+    if (x->time != y->time) {
+
+        return (x->time < y->time) ? -1 : 1;
+
+    }
+
+    if (x->pixel != y->pixel) {
+
+        return (x->pixel < y->pixel) ? -1 : 1;
+
+    }
+
+    return (x->sequence < y->sequence) ? -1 : (x->sequence > y->sequence);
+
+}
+
+int main(int argc, char* argv[])
+{
+
+    unsigned long pixels = 1;
+    unsigned long segment = 0;
+    unsigned long dead = ULONG_MAX;
+    int addressed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:ux:")) != -1) {
+
+        switch (opt) {
+
+            case 'n':
+                pixels = strtoul(optarg, NULL, 0);
+                break;
+
+            case 's':
+                segment = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'u':
+                addressed = 0;
+                break;
+
+            case 'x':
+                dead = strtoul(optarg, NULL, 0);
+                break;
+
+            default:
+                goto usage;
+
+        }
+
+    }
+
+    // The last pixel can't be bypassed, there is none following it
+    if (pixels < 1 || pixels > REPLAY_PIXELS_MAX || segment > UINT8_MAX
+        || argc - optind > 1 || (dead != ULONG_MAX && dead + 1 >= pixels)) {
+
+        goto usage;
+
+    }
+
+    FILE* capture = (optind < argc) ? fopen(argv[optind], "rb") : stdin;
+
+    if (!capture || capture_read_header(capture)) {
+
+        fprintf(stderr, "%s: not a capture\n",
+            (optind < argc) ? argv[optind] : "stdin");
+
+        return EXIT_FAILURE;
+
+    }
+
+    replay_segment = segment;
+
+    // Shared with the pixels, so that they can report their summary
+    replay_summary_t* summaries = mmap(NULL, pixels * sizeof(*summaries),
+        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    FILE* reports[REPLAY_PIXELS_MAX];
+    int master[2];
+
+    if (summaries == MAP_FAILED || pipe(master)) {
+
+        perror("replay");
+
+        return EXIT_FAILURE;
+
+    }
+
+    int in = master[0];
+
+    for (unsigned long i = 0; i < pixels; i++) {
+
+        int next[2] = {-1, -1};
+
+        // Leave the input to the pixel bypassing the dead one
+        if (i == dead) {
+
+            reports[i] = NULL;
+            summaries[i].address = PROTOCOL_ADDRESS_UNKNOWN;
+
+            continue;
+
+        }
+
+        reports[i] = tmpfile();
+
+        if (!reports[i] || (i + 1 < pixels && pipe(next))) {
+
+            perror("replay");
+
+            return EXIT_FAILURE;
+
+        }
+
+        fflush(NULL);
+        pid_t pid = fork();
+
+        if (pid < 0) {
+
+            perror("fork");
+
+            return EXIT_FAILURE;
+
+        }
+
+        if (pid == 0) {
+
+            close(master[1]);
+
+            if (next[0] >= 0) {
+
+                close(next[0]);
+
+            }
+
+            replay_pixel = i;
+            replay_report = reports[i];
+            replay_run(in, next[1], addressed, i == dead + 1, &summaries[i]);
+
+        }
+
+        close(in);
+
+        if (next[1] >= 0) {
+
+            close(next[1]);
+
+        }
+
+        in = next[0];
+
+    }
+
+    FILE* out = fdopen(master[1], "wb");
+    capture_record_t record;
+    int result;
+
+    if (!out || capture_write_header(out)) {
+
+        perror("pipe");
+
+        return EXIT_FAILURE;
+
+    }
+
+    while ((result = capture_read(capture, &record)) > 0) {
+
+        if (record.segment == segment && capture_write(out, &record)) {
+
+            perror("pipe");
+
+            return EXIT_FAILURE;
+
+        }
+
+    }
+
+    fclose(out);
+
+    if (result < 0) {
+
+        fprintf(stderr, "capture is truncated\n");
+
+    }
+
+    int status;
+    int failed = 0;
+
+    while (wait(&status) > 0) {
+
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+
+            failed = 1;
+
+        }
+
+    }
+
+    if (failed) {
+
+        fprintf(stderr, "replay failed\n");
+
+        return EXIT_FAILURE;
+
+    }
+
+    replay_event_t* events = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+
+    for (unsigned long i = 0; i < pixels; i++) {
+
+        if (!reports[i]) {
+
+            continue;
+
+        }
+
+        rewind(reports[i]);
+
+        while (1) {
+
+            if (count == capacity) {
+
+                capacity = capacity ? 2 * capacity : 1024;
+                events = realloc(events, capacity * sizeof(*events));
+
+                if (!events) {
+
+                    perror("replay");
+
+                    return EXIT_FAILURE;
+
+                }
+
+            }
+
+            if (fread(&events[count], sizeof(*events), 1, reports[i]) != 1) {
+
+                break;
+
+            }
+
+            count++;
+
+        }
+
+        fclose(reports[i]);
+
+    }
+
+    qsort(events, count, sizeof(*events), replay_compare);
+
+    for (size_t i = 0; i < count; i++) {
+
+        printf("%" PRIu64 " %u %u %u %u %u %u\n", events[i].time,
+            events[i].pixel, events[i].index, events[i].color.red,
+            events[i].color.green, events[i].color.blue,
+            events[i].color.white);
+
+    }
+
+    for (unsigned long i = 0; i < pixels; i++) {
+
+        printf("# pixel %lu: %lu bytes, %lu frames, %lu colors, "
+            "last byte at %" PRIu64 ", address %u\n", i,
+            summaries[i].received, summaries[i].frames, summaries[i].colors,
+            summaries[i].last, summaries[i].address);
+
+    }
+
+    free(events);
+
+    return (result < 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+
+usage:
+
+    fprintf(stderr, "usage: %s [-n PIXELS] [-s SEGMENT] [-u] [-x PIXEL] "
+        "[CAPTURE]\n", argv[0]);
+
+    return EXIT_FAILURE;
+
+}
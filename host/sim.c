@@ -0,0 +1,324 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file sim.c
+ *
+ * Implements the simulated pixel declared in sim.h
+ *
+ * Only the functions called by protocol.c are provided. Most of them merely
+ * count their invocation as an effect, as their outcome isn't observable on
+ * the bus anyway.
+ *
+ * @see sim.h
+ */
+
+#include <stddef.h>
+
+#include "bus.h"
+#include "clock.h"
+#include "cluster.h"
+#include "config.h"
+#include "pwm.h"
+#include "sim.h"
+#include "stream.h"
+#include "telemetry.h"
+#include "touch.h"
+#include "watchdog.h"
+
+/**
+ * @brief Time in microseconds after which the clock wraps around
+ */
+#define SIM_CLOCK_WRAP ((uint64_t)CLOCK_TICK << 16)
+
+/**
+ * Callback for bytes sent to the downstream neighbour, if any
+ */
+static sim_send_t sim_send = NULL;
+
+/**
+ * Callback for colors being applied, if any
+ */
+static sim_color_t sim_color = NULL;
+
+/**
+ * Touch state reported by the simulated pixel
+ */
+static uint8_t sim_touched = 0;
+
+/**
+ * State of the link reported by the simulated pixel
+ */
+static uint8_t sim_link_state = 0;
+
+/**
+ * Counters of things that happened so far
+ */
+static sim_counters_t sim_counters;
+
+/**
+ * Current simulated time in microseconds
+ */
+static uint64_t sim_time = 0;
+
+/**
+ * Simulated time the clock has been zero the last time (modulo its wrap)
+ */
+static uint64_t sim_clock_base = 0;
+
+/**
+ * Sets the callback for bytes sent to the downstream neighbour
+ *
+ * @param send Callback to invoke, NULL discards the bytes
+ */
+void sim_set_send(sim_send_t send)
+{
+
+    sim_send = send;
+
+}
+
+/**
+ * Sets the callback for colors being applied
+ *
+ * @param color Callback to invoke, NULL discards the colors
+ */
+void sim_set_color(sim_color_t color)
+{
+
+    sim_color = color;
+
+}
+
+/**
+ * Sets the touch state reported by the simulated pixel
+ *
+ * @param touched Non-zero value if the pixel is touched
+ */
+void sim_set_touched(uint8_t touched)
+{
+
+    sim_touched = touched;
+
+}
+
+/**
+ * Sets the state of the link reported by the simulated pixel
+ *
+ * @param state State of the link, e.g. {@link #BUS_LINK_BYPASSED} for a
+ * pixel receiving from the pixel two positions upstream
+ */
+void sim_set_link_state(uint8_t state)
+{
+
+    sim_link_state = state;
+
+}
+
+/**
+ * Sets the simulated time
+ *
+ * @param time Time in microseconds, which shouldn't go backwards
+ */
+void sim_set_time(uint64_t time)
+{
+
+    sim_time = time;
+
+}
+
+/**
+ * Returns the current time of the simulated clock
+ *
+ * @return Time in microseconds since the clock has wrapped the last time
+ */
+static uint64_t sim_clock()
+{
+
+    return (sim_time % SIM_CLOCK_WRAP + SIM_CLOCK_WRAP - sim_clock_base)
+        % SIM_CLOCK_WRAP;
+
+}
+
+/**
+ * Returns the counters of things that happened so far
+ *
+ * @param counters Pointer the counters are copied to
+ */
+void sim_get_counters(sim_counters_t* counters)
+{
+
+    *counters = sim_counters;
+
+}
+
+void bus_send(uint8_t byte)
+{
+
+    sim_counters.sent++;
+
+    if (sim_send) {
+
+        sim_send(byte);
+
+    }
+
+}
+
+void bus_set_link(uint8_t mode, uint16_t timeout)
+{
+
+    sim_counters.effects++;
+
+}
+
+uint8_t bus_get_link_state()
+{
+
+    return sim_link_state;
+
+}
+
+void clock_set(uint16_t ticks, uint16_t offset)
+{
+
+    uint64_t clock = ((uint64_t)ticks * CLOCK_TICK + offset) % SIM_CLOCK_WRAP;
+
+    sim_clock_base = (sim_time % SIM_CLOCK_WRAP + SIM_CLOCK_WRAP - clock)
+        % SIM_CLOCK_WRAP;
+
+    sim_counters.effects++;
+
+}
+
+void cluster_set_color_rgb(uint8_t index, const color_rgb_t* color)
+{
+
+    color_rgbw_t tmp = {color->red, color->green, color->blue, 0};
+
+    sim_counters.effects++;
+
+    if (sim_color) {
+
+        sim_color(sim_time, index, &tmp);
+
+    }
+
+}
+
+void config_save()
+{
+
+    sim_counters.effects++;
+
+}
+
+void pwm_set_color_rgbw(const color_rgbw_t* color)
+{
+
+    sim_counters.effects++;
+
+    if (sim_color) {
+
+        sim_color(sim_time, 0, color);
+
+    }
+
+}
+
+void pwm_set_interpolation(uint16_t period)
+{
+
+    sim_counters.effects++;
+
+}
+
+void pwm_set_mode(uint8_t mode)
+{
+
+    sim_counters.effects++;
+
+}
+
+void pwm_set_phase_alignment(uint8_t groups)
+{
+
+    sim_counters.effects++;
+
+}
+
+void pwm_sync(uint32_t time, uint8_t address)
+{
+
+    sim_counters.effects++;
+
+}
+
+void stream_queue(uint16_t time, const color_rgb_t* color)
+{
+
+    color_rgbw_t tmp = {color->red, color->green, color->blue, 0};
+
+    // Colors that are already late are presented right away
+    uint64_t delay = ((uint64_t)time * CLOCK_TICK + SIM_CLOCK_WRAP
+        - sim_clock()) % SIM_CLOCK_WRAP;
+
+    if (delay > SIM_CLOCK_WRAP / 2) {
+
+        delay = 0;
+
+    }
+
+    sim_counters.effects++;
+
+    if (sim_color) {
+
+        sim_color(sim_time + delay, 0, &tmp);
+
+    }
+
+}
+
+void telemetry_request()
+{
+
+    sim_counters.effects++;
+
+}
+
+void telemetry_sync(uint8_t slots)
+{
+
+    sim_counters.effects++;
+
+}
+
+uint8_t touch_is_touched()
+{
+
+    return sim_touched;
+
+}
+
+void watchdog_bus_activity()
+{
+
+    sim_counters.frames++;
+
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file sim.h
+ *
+ * Simulated pixel on the host
+ *
+ * This provides the functions protocol.c depends upon, so that the parser
+ * can be built for the host and fed with arbitrary bytes, e.g. by the
+ * fuzzing harness. Instead of driving any hardware, the simulated pixel
+ * passes the bytes sent to its downstream neighbour and the colors being
+ * applied to callbacks, and counts everything else that happens.
+ *
+ * Time is simulated, too: It only advances when set explicitly, which is
+ * usually done before each received byte. Colors
+ * {@link stream_queue() queued} for later presentation are reported with the
+ * time they are presented at, as derived from the simulated clock.
+ *
+ * As the parser keeps its state in static variables, there is only a single
+ * simulated pixel per process.
+ *
+ * @see sim.c
+ */
+
+#ifndef _LTT_HOST_SIM_H_
+#define _LTT_HOST_SIM_H_
+
+#include <inttypes.h>
+
+#include "color.h"
+
+/**
+ * Callback invoked for each byte sent to the downstream neighbour
+ */
+typedef void (*sim_send_t)(uint8_t byte);
+
+/**
+ * Callback invoked for each color applied to an LED of the pixel
+ *
+ * The time is given in microseconds. Index zero is the LED of the pixel
+ * itself, the others are the LEDs of its {@link cluster.h cluster}.
+ */
+typedef void (*sim_color_t)(uint64_t time, uint8_t index,
+    const color_rgbw_t* color);
+
+/**
+ * Counters of things that happened to the simulated pixel
+ */
+typedef struct {
+
+    /**
+     * @brief Bytes sent to the downstream neighbour
+     */
+    unsigned long sent;
+
+    /**
+     * @brief Frames received with a valid CRC
+     */
+    unsigned long frames;
+
+    /**
+     * @brief Commands that had an effect on the pixel
+     */
+    unsigned long effects;
+
+} sim_counters_t;
+
+void sim_set_send(sim_send_t send);
+void sim_set_color(sim_color_t color);
+void sim_set_touched(uint8_t touched);
+void sim_set_link_state(uint8_t state);
+void sim_set_time(uint64_t time);
+
+void sim_get_counters(sim_counters_t* counters);
+
+#endif /* _LTT_HOST_SIM_H_ */
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file adc.c
+ *
+ * Implements the ADC functionality declared in adc.h
+ *
+ * Conversions are performed in single conversion mode and are waited for
+ * actively. A single conversion takes 13 ADC clock cycles, i.e. roughly 100
+ * microseconds with the prescaler used here, which is short enough to be done
+ * from within the main loop.
+ *
+ * @see adc.h
+ */
+
+#include <avr/io.h>
+
+#include "adc.h"
+#include "hal.h"
+
+/**
+ * Initializes the ADC module
+ *
+ * This enables the ADC and sets up the prescaler, so that the ADC clock is
+ * within the range of 50 kHz to 200 kHz recommended by the datasheet.
+ */
+void adc_init()
+{
+
+    // Enable ADC, prescaler 64
+    ADCSRA = _BV(ADEN) | _BV(ADPS2) | _BV(ADPS1);
+
+}
+
+/**
+ * Performs a single conversion with the current settings
+ *
+ * @return Result of the conversion (10 bits)
+ */
+static uint16_t adc_convert()
+{
+
+    // Start conversion and wait for it to complete
+    ADCSRA |= _BV(ADSC);
+    while (ADCSRA & _BV(ADSC));
+
+    return ADC;
+
+}
+
+/**
+ * Performs a single conversion and returns its result
+ *
+ * When the reference voltage differs from the previous conversion, an
+ * additional conversion is performed and discarded.
+ *
+ * @note This function must not be invoked from within an interrupt, as it
+ * waits for the conversion to complete.
+ *
+ * @param channel Value of the `MUX` bits selecting the input channel
+ * @param reference {@link #ADC_REFERENCE_VCC} or {@link #ADC_REFERENCE_1V1}
+ *
+ * @return Result of the conversion (10 bits)
+ */
+uint16_t adc_read(uint8_t channel, uint8_t reference)
+{
+
+    // The first conversion after switching the reference is inaccurate
+    if (hal_adc_select(channel, reference)) {
+
+        adc_convert();
+
+    }
+
+    return adc_convert();
+
+}
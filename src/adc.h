@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file adc.h
+ *
+ * Functionality for sampling analog signals
+ *
+ * This module provides a minimal interface to the analog to digital converter
+ * of the microcontroller. It is shared by all of the modules that need to
+ * sample analog values, e.g. the {@link touch.h touch detection}.
+ *
+ * @see adc.c
+ */
+
+#ifndef _LTT_ADC_H_
+#define _LTT_ADC_H_
+
+#include <inttypes.h>
+
+/**
+ * @brief Reference voltage: VCC
+ */
+#define ADC_REFERENCE_VCC 0
+
+/**
+ * @brief Reference voltage: Internal 1.1V
+ */
+#define ADC_REFERENCE_1V1 1
+
+void adc_init();
+
+uint16_t adc_read(uint8_t channel, uint8_t reference);
+
+#endif /* _LTT_ADC_H_ */
@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file bcm.c
+ *
+ * Implements the binary code modulation declared in bcm.h
+ *
+ * The bit-planes are precomputed as port values, so that the interrupt only
+ * needs to write them to the port. They are computed into a separate buffer,
+ * which is copied over at the beginning of the next cycle once it has been
+ * {@link bcm_commit() committed}, so that a cycle never mixes old and new
+ * values.
+ *
+ * The spare timer restarts with each interrupt and is set to the length of
+ * the next bit-plane. The shortest bit-planes would need interrupts in quick
+ * succession, which could be delayed by other interrupts, though. Therefore
+ * the first {@link #BCM_SHORT_PLANES} bit-planes of each cycle are timed by
+ * polling the counter from within a single interrupt instead.
+ *
+ * The LEDs are active low, so a channel is on while its pin is low.
+ *
+ * @see bcm.h
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "bcm.h"
+#include "hal.h"
+
+#ifdef HAL_TIMER_SPARE_vect
+
+/**
+ * @brief Amount of bit-planes timed by polling
+ *
+ * These take 2^n - 1 ticks in total, which are spent within the interrupt.
+ */
+#define BCM_SHORT_PLANES 3
+
+/**
+ * @brief Ticks taken by all bit-planes timed by polling
+ */
+#define BCM_SHORT_TICKS ((1 << BCM_SHORT_PLANES) - 1)
+
+#if BCM_DEPTH <= BCM_SHORT_PLANES || BCM_DEPTH > 8
+
+    #error "BCM_DEPTH out of range"
+
+#endif
+
+/**
+ * Port the channels are attached to
+ */
+static volatile uint8_t* bcm_port;
+
+/**
+ * Pins of the port belonging to the channels
+ */
+static uint8_t bcm_mask;
+
+/**
+ * Bit-planes being output, each holding the levels of the pins
+ */
+static uint8_t bcm_planes[BCM_DEPTH];
+
+/**
+ * Bit-planes being computed
+ *
+ * @see bcm_set()
+ * @see bcm_commit()
+ */
+static uint8_t bcm_staging[BCM_DEPTH];
+
+/**
+ * Flag indicating whether the staging buffer is to be output
+ */
+static volatile uint8_t bcm_pending;
+
+/**
+ * Flag indicating whether the bit-planes are being output
+ */
+static volatile uint8_t bcm_running;
+
+/**
+ * Bit-plane to be output with the next interrupt
+ */
+static uint8_t bcm_plane;
+
+#endif
+
+/**
+ * Initializes the binary code modulation of the given pins
+ *
+ * The pins are set up as outputs with all channels turned off and the spare
+ * timer is started. No signals are output until bcm_start() is invoked.
+ *
+ * @param port `PORTx` register the channels are attached to
+ * @param mask Pins of the port belonging to the channels
+ */
+void bcm_init(volatile uint8_t* port, uint8_t mask)
+{
+
+    #ifdef HAL_TIMER_SPARE_vect
+
+        bcm_port = port;
+        bcm_mask = mask;
+
+        for (uint8_t i = 0; i < BCM_DEPTH; i++) {
+
+            bcm_planes[i] = mask;
+            bcm_staging[i] = mask;
+
+        }
+
+        // DDRx is located right in front of PORTx, see ports.h
+        *port |= mask;
+        *(port - 1) |= mask;
+
+        hal_timer_spare_init();
+
+    #endif
+
+}
+
+/**
+ * Starts the output of the bit-planes
+ *
+ * @see bcm_stop()
+ */
+void bcm_start()
+{
+
+    #ifdef HAL_TIMER_SPARE_vect
+
+        bcm_running = 1;
+
+    #endif
+
+}
+
+/**
+ * Stops the output of the bit-planes and turns off all channels
+ *
+ * @see bcm_start()
+ */
+void bcm_stop()
+{
+
+    #ifdef HAL_TIMER_SPARE_vect
+
+        // Save global interrupt flag and disable interrupts
+        uint8_t tmp = SREG;
+        cli();
+
+        bcm_running = 0;
+        *bcm_port |= bcm_mask;
+
+        // Restore global interrupt flag
+        SREG = tmp;
+
+    #endif
+
+}
+
+/**
+ * Sets the brightness of a single channel
+ *
+ * The value is reduced to {@link #BCM_DEPTH} bits and spread across the
+ * bit-planes being computed. It doesn't take effect before bcm_commit() is
+ * invoked, so that multiple channels can be changed at once.
+ *
+ * @note This must not be interrupted by other invocations of bcm_set() or
+ * bcm_commit().
+ *
+ * @param bit Pin of the channel within the port
+ * @param value Brightness in the linear domain (16 bits)
+ */
+void bcm_set(uint8_t bit, uint16_t value)
+{
+
+    #ifdef HAL_TIMER_SPARE_vect
+
+        // Round, so that dim values don't vanish entirely
+        uint16_t rounded = (value >> (16 - BCM_DEPTH))
+            + ((value >> (15 - BCM_DEPTH)) & 0x01);
+
+        if (rounded >= (1 << BCM_DEPTH)) {
+
+            rounded = (1 << BCM_DEPTH) - 1;
+
+        }
+
+        uint8_t mask = _BV(bit);
+
+        for (uint8_t i = 0; i < BCM_DEPTH; i++) {
+
+            // Active low
+            if (rounded & 0x01) {
+
+                bcm_staging[i] &= ~mask;
+
+            } else {
+
+                bcm_staging[i] |= mask;
+
+            }
+
+            rounded >>= 1;
+
+        }
+
+    #endif
+
+}
+
+/**
+ * Outputs the bit-planes computed so far, starting with the next cycle
+ *
+ * @see bcm_set()
+ */
+void bcm_commit()
+{
+
+    #ifdef HAL_TIMER_SPARE_vect
+
+        bcm_pending = 1;
+
+    #endif
+
+}
+
+#ifdef HAL_TIMER_SPARE_vect
+
+/**
+ * Writes the given bit-plane to the port
+ *
+ * @param plane Levels of the pins belonging to the channels
+ */
+static inline void bcm_write(uint8_t plane)
+{
+
+    *bcm_port = (*bcm_port & ~bcm_mask) | plane;
+
+}
+
+/**
+ * Outputs the next bit-plane
+ *
+ * At the beginning of a cycle the short bit-planes are output by polling the
+ * counter, which keeps on counting from the interrupt, as the next interrupt
+ * is set up right away.
+ */
+ISR(HAL_TIMER_SPARE_vect)
+{
+
+    if (!bcm_running) {
+
+        return;
+
+    }
+
+    uint8_t plane = bcm_plane;
+
+    if (plane == 0) {
+
+        if (bcm_pending) {
+
+            for (uint8_t i = 0; i < BCM_DEPTH; i++) {
+
+                bcm_planes[i] = bcm_staging[i];
+
+            }
+
+            bcm_pending = 0;
+
+        }
+
+        hal_timer_spare_set(BCM_SHORT_TICKS + (1 << BCM_SHORT_PLANES));
+
+        for (; plane < BCM_SHORT_PLANES; plane++) {
+
+            bcm_write(bcm_planes[plane]);
+
+            while (hal_timer_spare_count() < (2 << plane) - 1);
+
+        }
+
+    } else {
+
+        hal_timer_spare_set(1 << plane);
+
+    }
+
+    bcm_write(bcm_planes[plane]);
+
+    bcm_plane = (plane + 1 == BCM_DEPTH) ? 0 : plane + 1;
+
+}
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file bcm.h
+ *
+ * Binary code modulation of the pins of a single port
+ *
+ * Binary code modulation (BCM) splits the brightness of each channel into
+ * its bits and outputs these as bit-planes: Bit n of all channels is output
+ * at once for 2^n ticks. Thus a whole cycle takes a single port write per
+ * bit-plane, independent of the amount of channels, which makes it possible
+ * to drive many LEDs in software.
+ *
+ * This needs a spare timer, see hal.h.
+ *
+ * @see bcm.c
+ */
+
+#ifndef _LTT_BCM_H_
+#define _LTT_BCM_H_
+
+#include <inttypes.h>
+
+#ifndef BCM_DEPTH
+
+    /**
+     * @brief Resolution in bits, i.e. amount of bit-planes
+     *
+     * With eight bits a cycle takes 255 ticks of the spare timer, i.e. about
+     * 2 ms at 8 MHz.
+     */
+    #define BCM_DEPTH 8
+
+#endif
+
+void bcm_init(volatile uint8_t* port, uint8_t mask);
+
+void bcm_start();
+void bcm_stop();
+
+void bcm_set(uint8_t bit, uint16_t value);
+void bcm_commit();
+
+#endif /* _LTT_BCM_H_ */
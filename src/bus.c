@@ -0,0 +1,593 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file bus.c
+ *
+ * Implements the bus functionality declared in bus.h
+ *
+ * `USART0` is used for the bus, receiving from the upstream neighbour on
+ * `RXD0` and transmitting to the downstream neighbour on `TXD0`. Frames are
+ * forwarded on a byte by byte basis (cut-through), i.e. each byte is passed
+ * on to the {@link protocol.h protocol} as soon as it has been received and
+ * whatever the protocol returns is transmitted right away. This keeps the
+ * latency per pixel at roughly a single byte.
+ *
+ * As the transmitter runs at the same rate as the receiver, the transmit
+ * buffer is only needed to bridge short periods of time in which the
+ * transmitter is still busy with a previous byte.
+ *
+ * The links are supervised once per {@link clock.h tick}: The input is
+ * considered silent when no valid byte has been received for the configured
+ * timeout, and stuck when it has been low for {@link #BUS_STUCK_TICKS}. The
+ * output is considered stuck when it reads back low while the transmitter
+ * is idle, e.g. because it has been shorted. The time between the last valid
+ * byte and the detection of a fault is recorded, as is the amount of faults.
+ *
+ * The input that isn't selected is sampled once per tick, too. It is
+ * considered active when it has gone low and back high again (without being
+ * stuck) within the silence timeout. In {@link #BUS_LINK_AUTO automatic mode}
+ * the alternate input is only selected while the regular input is silent or
+ * stuck and the alternate input is active, so that a pause of the master
+ * doesn't make all pixels bypass their neighbours at once. The regular input
+ * is selected again as soon as it becomes active, or when the alternate input
+ * fails, too.
+ *
+ * The alternate input is implemented by remapping `USART0` to its alternate
+ * pins (`U0MAP`), which moves the transmitter, too. Therefore both
+ * transmitter pins need to be connected to the downstream neighbour. The
+ * unused one is an input while remapped, so they don't interfere.
+ *
+ * @see bus.h
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#define BAUD BUS_BAUD
+#include <util/setbaud.h>
+
+#include "bus.h"
+#include "clock.h"
+#include "hal.h"
+#include "pins.h"
+#include "protocol.h"
+
+/**
+ * @brief Size of the transmit buffer, must be a power of two
+ */
+#define BUS_TX_BUFFER_SIZE 16
+
+/**
+ * Buffer holding bytes waiting to be transmitted
+ *
+ * @see bus_tx_head
+ * @see bus_tx_tail
+ */
+static volatile uint8_t bus_tx_buffer[BUS_TX_BUFFER_SIZE];
+
+/**
+ * Index of the position the next byte will be put at
+ */
+static volatile uint8_t bus_tx_head = 0;
+
+/**
+ * Index of the next byte to be transmitted
+ */
+static volatile uint8_t bus_tx_tail = 0;
+
+/**
+ * Mode of the link
+ *
+ * @see bus_set_link()
+ */
+static uint8_t bus_link_mode = BUS_LINK_NORMAL;
+
+/**
+ * State of the link, see e.g. {@link #BUS_LINK_SILENT}
+ */
+static volatile uint8_t bus_link_state = 0;
+
+/**
+ * Amount of faults that have been detected (saturating)
+ */
+static uint8_t bus_link_faults = 0;
+
+/**
+ * Time between the last valid byte and the detection of the last fault
+ */
+static uint16_t bus_detection_time = 0;
+
+/**
+ * Time without valid bytes until the input is considered silent (ticks)
+ */
+static uint16_t bus_silent_timeout = 1000000UL / CLOCK_TICK;
+
+/**
+ * Whether a valid byte has been received since the last tick
+ */
+static volatile uint8_t bus_rx_active = 0;
+
+/**
+ * Amount of ticks since the last valid byte
+ */
+static uint16_t bus_rx_silent = 0;
+
+/**
+ * Amount of consecutive ticks the input has been low
+ */
+static uint8_t bus_rx_low = 0;
+
+/**
+ * Amount of consecutive ticks the output has been low while idle
+ */
+static uint8_t bus_tx_low = 0;
+
+/**
+ * Amount of ticks since the input not selected has been active
+ */
+static uint16_t bus_other_idle = UINT16_MAX;
+
+/**
+ * Amount of consecutive ticks the input not selected has been low
+ */
+static uint8_t bus_other_low = 0;
+
+/**
+ * Enables the USART
+ */
+static void bus_enable()
+{
+
+    // Enable receiver, transmitter and receive complete interrupt
+    UCSR0B = _BV(RXCIE0) | _BV(RXEN0) | _BV(TXEN0);
+
+    if (bus_tx_head != bus_tx_tail) {
+
+        UCSR0B |= _BV(UDRIE0);
+
+    }
+
+}
+
+/**
+ * Switches between the regular and the alternate input
+ *
+ * The USART is shortly disabled, so that the pins are released before being
+ * remapped. Any byte currently being received or transmitted is lost.
+ *
+ * @note Without {@link #HAL_BUS_REMAP} the regular input is always used.
+ *
+ * @param alternate Non-zero value to use the alternate input
+ */
+static void bus_select_input(uint8_t alternate)
+{
+
+    #ifndef HAL_BUS_REMAP
+
+        alternate = 0;
+
+    #endif
+
+    UCSR0B = 0;
+
+    hal_bus_select_input(alternate);
+
+    if (alternate) {
+
+        bus_link_state |= BUS_LINK_BYPASSED;
+
+    } else {
+
+        bus_link_state &= ~BUS_LINK_BYPASSED;
+
+    }
+
+    bus_enable();
+
+    // Restart the supervision for both inputs, which have been swapped
+    bus_link_state &= ~(BUS_LINK_SILENT | BUS_LINK_STUCK);
+    bus_rx_silent = 0;
+    bus_rx_low = 0;
+    bus_other_idle = UINT16_MAX;
+    bus_other_low = 0;
+
+}
+
+/**
+ * Initializes the bus module
+ *
+ * This sets up the USART with the {@link #BUS_BAUD baud rate} of the bus and
+ * a frame format of 8N1. Received bytes are handled by an interrupt, so
+ * interrupts need to be enabled globally for the bus to work.
+ */
+void bus_init()
+{
+
+    UBRR0 = UBRR_VALUE;
+
+    #if USE_2X
+
+        UCSR0A |= _BV(U2X0);
+
+    #else
+
+        UCSR0A &= ~_BV(U2X0);
+
+    #endif
+
+    // 8N1
+    UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
+
+    // Enable pull-ups, so that unconnected inputs don't float
+    HAL_SET_PULLUP(PIN_BUS_RX);
+    HAL_SET_PULLUP(PIN_BUS_RX_ALT);
+
+    bus_enable();
+
+}
+
+/**
+ * Writes the given byte into the data register of the USART
+ *
+ * The transmit complete flag is cleared beforehand, so that it indicates
+ * whether the transmitter is idle.
+ *
+ * @param byte Byte to transmit
+ */
+static inline void bus_transmit(uint8_t byte)
+{
+
+    UCSR0A |= _BV(TXC0);
+    UDR0 = byte;
+
+}
+
+/**
+ * Transmits the given byte to the downstream neighbour
+ *
+ * The byte is written to the USART directly if possible, otherwise it is put
+ * into the {@link #bus_tx_buffer transmit buffer}. If the buffer is full, the
+ * byte is dropped.
+ *
+ * @note This can be called from within interrupts as well as from the main
+ * loop, as interrupts are shortly disabled while accessing the buffer.
+ *
+ * @param byte Byte to transmit
+ */
+void bus_send(uint8_t byte)
+{
+
+    // Save global interrupt flag and disable interrupts
+    uint8_t tmp = SREG;
+    cli();
+
+    if (bus_tx_head == bus_tx_tail && (UCSR0A & _BV(UDRE0))) {
+
+        bus_transmit(byte);
+
+    } else {
+
+        uint8_t head = (bus_tx_head + 1) & (BUS_TX_BUFFER_SIZE - 1);
+
+        if (head != bus_tx_tail) {
+
+            bus_tx_buffer[bus_tx_head] = byte;
+            bus_tx_head = head;
+
+            // Enable data register empty interrupt
+            UCSR0B |= _BV(UDRIE0);
+
+        }
+
+    }
+
+    // Restore global interrupt flag
+    SREG = tmp;
+
+}
+
+/**
+ * Sets the mode of the link
+ *
+ * @param mode Mode of the link, e.g. {@link #BUS_LINK_AUTO}
+ * @param timeout Time without valid bytes until the input is considered
+ * silent (ticks)
+ */
+void bus_set_link(uint8_t mode, uint16_t timeout)
+{
+
+    // Save global interrupt flag and disable interrupts
+    uint8_t tmp = SREG;
+    cli();
+
+    bus_link_mode = mode;
+
+    if (timeout) {
+
+        bus_silent_timeout = timeout;
+
+    }
+
+    if (mode == BUS_LINK_NORMAL && (bus_link_state & BUS_LINK_BYPASSED)) {
+
+        bus_select_input(0);
+
+    } else if (mode == BUS_LINK_BYPASS
+        && !(bus_link_state & BUS_LINK_BYPASSED)) {
+
+        bus_select_input(1);
+
+    }
+
+    // Restore global interrupt flag
+    SREG = tmp;
+
+}
+
+/**
+ * Returns the mode of the link
+ *
+ * @return Mode of the link, e.g. {@link #BUS_LINK_AUTO}
+ */
+uint8_t bus_get_link_mode()
+{
+
+    return bus_link_mode;
+
+}
+
+/**
+ * Takes note of a newly detected fault
+ *
+ * @param fault Fault that has been detected, e.g. {@link #BUS_LINK_SILENT}
+ */
+static void bus_fault(uint8_t fault)
+{
+
+    if (bus_link_state & fault) {
+
+        return;
+
+    }
+
+    bus_link_state |= fault;
+    bus_detection_time = bus_rx_silent;
+
+    if (bus_link_faults != UINT8_MAX) {
+
+        bus_link_faults++;
+
+    }
+
+}
+
+#ifdef HAL_BUS_REMAP
+
+/**
+ * Selects the input automatically based upon the supervision of both inputs
+ *
+ * Switching inputs restarts the supervision, so an input that has failed is
+ * tried again once it becomes active again.
+ */
+static void bus_select_input_auto()
+{
+
+    uint8_t failed = bus_link_state & (BUS_LINK_SILENT | BUS_LINK_STUCK);
+    uint8_t other_active = bus_other_idle < bus_silent_timeout;
+
+    if (bus_link_state & BUS_LINK_BYPASSED) {
+
+        // Prefer the regular input whenever it carries traffic
+        if (failed || bus_other_idle == 0) {
+
+            bus_select_input(0);
+
+        }
+
+    } else if (failed && other_active) {
+
+        bus_select_input(1);
+
+    }
+
+}
+
+#endif
+
+/**
+ * Supervises the links
+ *
+ * @note This is expected to be called from within the interrupt of the
+ * {@link clock.h clock}.
+ */
+void bus_tick()
+{
+
+    if (bus_rx_active) {
+
+        bus_rx_active = 0;
+        bus_rx_silent = 0;
+        bus_link_state &= ~(BUS_LINK_SILENT | BUS_LINK_STUCK);
+
+    } else if (bus_rx_silent != UINT16_MAX) {
+
+        bus_rx_silent++;
+
+    }
+
+    uint8_t rx_high = (bus_link_state & BUS_LINK_BYPASSED)
+        ? IS_HIGH(PIN_BUS_RX_ALT) : IS_HIGH(PIN_BUS_RX);
+
+    bus_rx_low = rx_high ? 0 : bus_rx_low + (bus_rx_low != UINT8_MAX);
+
+    uint8_t other_high = (bus_link_state & BUS_LINK_BYPASSED)
+        ? IS_HIGH(PIN_BUS_RX) : IS_HIGH(PIN_BUS_RX_ALT);
+
+    // Low levels that end before the line is considered stuck are traffic
+    if (other_high && bus_other_low && bus_other_low < BUS_STUCK_TICKS) {
+
+        bus_other_idle = 0;
+
+    } else if (bus_other_idle != UINT16_MAX) {
+
+        bus_other_idle++;
+
+    }
+
+    bus_other_low = other_high
+        ? 0 : bus_other_low + (bus_other_low != UINT8_MAX);
+
+    uint8_t tx_high = (bus_link_state & BUS_LINK_BYPASSED)
+        ? IS_HIGH(PIN_BUS_TX_ALT) : IS_HIGH(PIN_BUS_TX);
+    uint8_t tx_idle = (bus_tx_head == bus_tx_tail)
+        && (UCSR0A & _BV(TXC0));
+
+    if (tx_high || !tx_idle) {
+
+        bus_tx_low = 0;
+        bus_link_state &= ~BUS_LINK_DOWNSTREAM;
+
+    } else if (bus_tx_low != UINT8_MAX) {
+
+        bus_tx_low++;
+
+    }
+
+    if (bus_rx_low >= BUS_STUCK_TICKS) {
+
+        bus_fault(BUS_LINK_STUCK);
+
+    } else if (bus_rx_silent >= bus_silent_timeout) {
+
+        bus_fault(BUS_LINK_SILENT);
+
+    }
+
+    if (bus_tx_low >= BUS_STUCK_TICKS) {
+
+        bus_fault(BUS_LINK_DOWNSTREAM);
+
+    }
+
+    #ifdef HAL_BUS_REMAP
+
+        if (bus_link_mode == BUS_LINK_AUTO) {
+
+            bus_select_input_auto();
+
+        }
+
+    #endif
+
+}
+
+/**
+ * Returns the state of the link
+ *
+ * @return State of the link, e.g. {@link #BUS_LINK_SILENT}
+ */
+uint8_t bus_get_link_state()
+{
+
+    return bus_link_state;
+
+}
+
+/**
+ * Returns the amount of faults that have been detected
+ *
+ * @return Amount of faults (saturating)
+ */
+uint8_t bus_get_link_faults()
+{
+
+    return bus_link_faults;
+
+}
+
+/**
+ * Returns the time it took to detect the last fault
+ *
+ * This is the time between the last valid byte and the detection.
+ *
+ * @return Time in ticks
+ */
+uint16_t bus_get_detection_time()
+{
+
+    // Save global interrupt flag and disable interrupts
+    uint8_t tmp = SREG;
+    cli();
+
+    uint16_t time = bus_detection_time;
+
+    // Restore global interrupt flag
+    SREG = tmp;
+
+    return time;
+
+}
+
+/**
+ * Handles received bytes
+ *
+ * Each received byte is passed on to the protocol, which forwards it to the
+ * downstream neighbour. Bytes with a frame error (e.g. caused by a line stuck
+ * low) are dropped.
+ *
+ * @see protocol_process()
+ * @see bus_send()
+ */
+ISR(USART0_RX_vect)
+{
+
+    uint8_t status = UCSR0A;
+    uint8_t byte = UDR0;
+
+    if (status & _BV(FE0)) {
+
+        return;
+
+    }
+
+    bus_rx_active = 1;
+
+    protocol_process(byte);
+
+}
+
+/**
+ * Transmits the next byte of the transmit buffer
+ *
+ * Once the buffer is empty, this interrupt disables itself.
+ */
+ISR(USART0_UDRE_vect)
+{
+
+    bus_transmit(bus_tx_buffer[bus_tx_tail]);
+    bus_tx_tail = (bus_tx_tail + 1) & (BUS_TX_BUFFER_SIZE - 1);
+
+    if (bus_tx_tail == bus_tx_head) {
+
+        UCSR0B &= ~_BV(UDRIE0);
+
+    }
+
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file bus.h
+ *
+ * Functionality for communicating over the bus
+ *
+ * The pixels are daisy chained: Each pixel receives data from its upstream
+ * neighbour (or the master for the first pixel) and forwards it to its
+ * downstream neighbour. The output of the last pixel is fed back into the
+ * master, so that the chain forms a ring. This way every frame eventually
+ * returns to the master, including any data the pixels have added to it.
+ *
+ * To keep a single dead pixel from blacking out everything downstream, each
+ * pixel additionally receives the output of the pixel two positions upstream
+ * on an alternate input. A pixel whose upstream link is silent or stuck can
+ * switch to this alternate input, bypassing its dead neighbour. The state of
+ * the links is reported by means of {@link telemetry.h telemetry}, which
+ * still reaches the master from pixels downstream of a broken link.
+ *
+ * @see bus.c
+ */
+
+#ifndef _LTT_BUS_H_
+#define _LTT_BUS_H_
+
+#include <inttypes.h>
+
+#ifndef BUS_BAUD
+
+    /**
+     * @brief Baud rate of the bus
+     */
+    #define BUS_BAUD 250000UL
+
+#endif
+
+/**
+ * @brief Time in microseconds it takes to transmit a single byte (8N1)
+ */
+#define BUS_BYTE_TIME ((10 * 1000000UL + BUS_BAUD - 1) / BUS_BAUD)
+
+/**
+ * @brief Delay in microseconds a byte experiences while passing a pixel
+ *
+ * A byte is forwarded once it has been received completely, so it is delayed
+ * by the time it takes to transmit a byte, plus the time it takes to handle
+ * the receive interrupt.
+ */
+#define BUS_HOP_DELAY (BUS_BYTE_TIME + 2)
+
+/**
+ * @brief Link mode: Always receive from the upstream neighbour
+ */
+#define BUS_LINK_NORMAL 0
+
+/**
+ * @brief Link mode: Always receive from the alternate input (bypass)
+ */
+#define BUS_LINK_BYPASS 1
+
+/**
+ * @brief Link mode: Bypass the upstream neighbour while it has failed
+ *
+ * The alternate input is only used while the regular input is silent or
+ * stuck and the alternate input carries traffic.
+ */
+#define BUS_LINK_AUTO 2
+
+/**
+ * @brief Link state: Nothing has been received for the silence timeout
+ */
+#define BUS_LINK_SILENT 0x01
+
+/**
+ * @brief Link state: The input is stuck at a low level
+ */
+#define BUS_LINK_STUCK 0x02
+
+/**
+ * @brief Link state: The output towards the downstream neighbour is stuck low
+ */
+#define BUS_LINK_DOWNSTREAM 0x04
+
+/**
+ * @brief Link state: The alternate input is being used
+ */
+#define BUS_LINK_BYPASSED 0x08
+
+/**
+ * @brief Amount of ticks a line needs to be low to be considered stuck
+ *
+ * A single byte keeps the line low for at most nine bit times, so anything
+ * longer than that can't be regular traffic.
+ */
+#define BUS_STUCK_TICKS 10
+
+void bus_init();
+
+void bus_send(uint8_t byte);
+
+void bus_set_link(uint8_t mode, uint16_t timeout);
+uint8_t bus_get_link_mode();
+
+void bus_tick();
+
+uint8_t bus_get_link_state();
+uint8_t bus_get_link_faults();
+uint16_t bus_get_detection_time();
+
+#endif /* _LTT_BUS_H_ */
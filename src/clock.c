@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file clock.c
+ *
+ * Implements the clock declared in clock.h
+ *
+ * Timer 0 is used in CTC mode with a prescaler of 8, so that its counter is
+ * incremented every microsecond (assuming a clock of 8 MHz) and a compare
+ * match occurs once every {@link #CLOCK_TICK tick}. The counter itself is
+ * used to set the clock with a resolution of a single microsecond.
+ *
+ * @see clock.h
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "bus.h"
+#include "clock.h"
+#include "stream.h"
+#include "telemetry.h"
+
+/**
+ * @brief Counter increments per microsecond
+ */
+#define CLOCK_COUNTS_PER_US (F_CPU / 8 / 1000000UL)
+
+/**
+ * Current time in ticks
+ *
+ * @see clock_now()
+ * @see clock_set()
+ */
+static volatile uint16_t clock_ticks = 0;
+
+/**
+ * Initializes the clock module
+ *
+ * @note The clock only advances while interrupts are enabled globally.
+ */
+void clock_init()
+{
+
+    OCR0A = CLOCK_COUNTS_PER_US * CLOCK_TICK - 1;
+
+    // CTC, prescaler 8
+    TCCR0A = _BV(WGM01);
+    TCCR0B = _BV(CS01);
+
+    // Enable compare match interrupt
+    TIMSK0 = _BV(OCIE0A);
+
+}
+
+/**
+ * Returns the current time
+ *
+ * @return Current time in ticks
+ */
+uint16_t clock_now()
+{
+
+    // Save global interrupt flag and disable interrupts
+    uint8_t tmp = SREG;
+    cli();
+
+    uint16_t ticks = clock_ticks;
+
+    // Restore global interrupt flag
+    SREG = tmp;
+
+    return ticks;
+
+}
+
+/**
+ * Sets the current time
+ *
+ * The offset allows to account for the time that has passed since the given
+ * time was valid, e.g. while the frame carrying it was passed along the
+ * chain.
+ *
+ * @param ticks Time in ticks
+ * @param offset Time in microseconds to add to the given time
+ */
+void clock_set(uint16_t ticks, uint16_t offset)
+{
+
+    // Save global interrupt flag and disable interrupts
+    uint8_t tmp = SREG;
+    cli();
+
+    clock_ticks = ticks + offset / CLOCK_TICK;
+    TCNT0 = (offset % CLOCK_TICK) * CLOCK_COUNTS_PER_US;
+
+    // Restore global interrupt flag
+    SREG = tmp;
+
+}
+
+/**
+ * Advances the clock by a single tick
+ *
+ * @see bus_tick()
+ * @see stream_tick()
+ * @see telemetry_tick()
+ */
+ISR(TIMER0_COMPA_vect)
+{
+
+    clock_ticks++;
+
+    bus_tick();
+    stream_tick();
+    telemetry_tick();
+
+}
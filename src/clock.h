@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file clock.h
+ *
+ * Time base synchronized across the whole table
+ *
+ * The clock counts {@link #CLOCK_TICK ticks} of a fixed length. It is set by
+ * the master by means of {@link #PROTOCOL_COMMAND_SYNC_CLOCK} frames, so that
+ * all of the pixels share a common notion of time, which in return can be
+ * used to schedule things at the same time throughout the table.
+ *
+ * @see clock.c
+ */
+
+#ifndef _LTT_CLOCK_H_
+#define _LTT_CLOCK_H_
+
+#include <inttypes.h>
+
+/**
+ * @brief Length of a single tick in microseconds
+ */
+#define CLOCK_TICK 100
+
+void clock_init();
+
+uint16_t clock_now();
+void clock_set(uint16_t ticks, uint16_t offset);
+
+#endif /* _LTT_CLOCK_H_ */
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file cluster.c
+ *
+ * Implements the additional LEDs declared in cluster.h
+ *
+ * The channels of the additional LEDs are attached to consecutive pins of a
+ * single port starting at {@link #PIN_CLUSTER}, red, green and blue for each
+ * LED. They are driven by {@link bcm.h binary code modulation}, so that the
+ * amount of LEDs hardly affects the time spent in interrupts.
+ *
+ * Colors are looked up in the same {@link pwm_lookup() table} as for the
+ * pixel's own LED and are {@link pwm_get_limit() limited} the same way.
+ * Neither interpolation nor any of the other PWM modes apply to the
+ * additional LEDs.
+ *
+ * @see cluster.h
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "bcm.h"
+#include "cluster.h"
+#include "hal.h"
+#include "pins.h"
+#include "pwm.h"
+
+#if CLUSTER_LEDS > 0
+
+#if !defined(HAL_TIMER_SPARE_vect)
+
+    #error "Additional LEDs need a spare timer"
+
+#elif BIT(PIN_CLUSTER) + CLUSTER_CHANNELS > 8
+
+    #error "Additional LEDs don't fit into a single port"
+
+#endif
+
+/**
+ * @brief Pins of all channels within the port
+ */
+#define CLUSTER_MASK (((1 << CLUSTER_CHANNELS) - 1) << BIT(PIN_CLUSTER))
+
+/**
+ * Colors of the additional LEDs
+ *
+ * These are kept, so that the output can be recomputed once the limit
+ * changes.
+ */
+static color_rgb_t cluster_colors[CLUSTER_LEDS];
+
+/**
+ * Limit the output has been computed for
+ *
+ * @see cluster_update()
+ */
+static uint8_t cluster_limit = UINT8_MAX;
+
+/**
+ * Computes the output of the given LED
+ *
+ * @note This must not be interrupted by another invocation.
+ *
+ * @param index Index of the additional LED (starting with zero)
+ */
+static void cluster_compute(uint8_t index)
+{
+
+    const uint8_t* components = &cluster_colors[index].red;
+
+    for (uint8_t i = 0; i < 3; i++) {
+
+        uint32_t value = pwm_lookup(components[i]);
+
+        value = (value * (cluster_limit + 1)) >> 8;
+
+        bcm_set(BIT(PIN_CLUSTER) + 3 * index + i, value);
+
+    }
+
+}
+
+#endif
+
+/**
+ * Initializes the additional LEDs
+ *
+ * The pins are set up as outputs with the LEDs turned off. No signals are
+ * output until cluster_enable() is invoked.
+ */
+void cluster_init()
+{
+
+    #if CLUSTER_LEDS > 0
+
+        bcm_init(&PORT(PIN_CLUSTER), CLUSTER_MASK);
+
+    #endif
+
+}
+
+/**
+ * Turns on the output of the additional LEDs
+ *
+ * @see cluster_disable()
+ */
+void cluster_enable()
+{
+
+    #if CLUSTER_LEDS > 0
+
+        bcm_start();
+
+    #endif
+
+}
+
+/**
+ * Turns off the additional LEDs
+ *
+ * @see cluster_enable()
+ */
+void cluster_disable()
+{
+
+    #if CLUSTER_LEDS > 0
+
+        bcm_stop();
+
+    #endif
+
+}
+
+/**
+ * Sets the color of a LED within the cluster
+ *
+ * Index zero refers to the pixel's own LED, which is the same as
+ * pwm_set_color_rgb(). Indices beyond the cluster are ignored.
+ *
+ * @note This is expected to be called from within the receive interrupt of
+ * the bus.
+ *
+ * @param index Index of the LED within the cluster
+ * @param color Color to output
+ */
+void cluster_set_color_rgb(uint8_t index, const color_rgb_t* color)
+{
+
+    if (index == 0) {
+
+        pwm_set_color_rgb(color);
+
+        return;
+
+    }
+
+    #if CLUSTER_LEDS > 0
+
+        if (index <= CLUSTER_LEDS) {
+
+            cluster_colors[index - 1] = *color;
+            cluster_compute(index - 1);
+            bcm_commit();
+
+        }
+
+    #endif
+
+}
+
+/**
+ * Recomputes the output once the limit of the brightness has changed
+ *
+ * This is expected to be called periodically from within the main loop.
+ */
+void cluster_update()
+{
+
+    #if CLUSTER_LEDS > 0
+
+        uint8_t limit = pwm_get_limit();
+
+        if (limit == cluster_limit) {
+
+            return;
+
+        }
+
+        // Save global interrupt flag and disable interrupts
+        uint8_t tmp = SREG;
+        cli();
+
+        cluster_limit = limit;
+
+        for (uint8_t i = 0; i < CLUSTER_LEDS; i++) {
+
+            cluster_compute(i);
+
+        }
+
+        bcm_commit();
+
+        // Restore global interrupt flag
+        SREG = tmp;
+
+    #endif
+
+}
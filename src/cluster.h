@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file cluster.h
+ *
+ * Additional LEDs driven by a single pixel
+ *
+ * Besides its own LED, which is driven by the hardware PWM of the
+ * {@link pwm.h PWM module}, a pixel can drive a cluster of additional RGB
+ * LEDs. These share a single bus address with the pixel, so that the master
+ * needs to service fewer nodes. Within the cluster the LEDs are numbered
+ * starting with zero for the pixel's own LED.
+ *
+ * The amount of additional LEDs is set at build time with
+ * {@link #CLUSTER_LEDS}, e.g. `-DCLUSTER_LEDS=2`. This needs a
+ * microcontroller with a spare timer and enough free pins, see hal.h and
+ * pins.h.
+ *
+ * @see cluster.c
+ */
+
+#ifndef _LTT_CLUSTER_H_
+#define _LTT_CLUSTER_H_
+
+#include <inttypes.h>
+
+#include "color.h"
+
+#ifndef CLUSTER_LEDS
+
+    /**
+     * @brief Amount of additional LEDs driven by this pixel
+     */
+    #define CLUSTER_LEDS 0
+
+#endif
+
+/**
+ * @brief Amount of channels of the additional LEDs
+ */
+#define CLUSTER_CHANNELS (3 * CLUSTER_LEDS)
+
+void cluster_init();
+
+void cluster_enable();
+void cluster_disable();
+
+void cluster_set_color_rgb(uint8_t index, const color_rgb_t* color);
+
+void cluster_update();
+
+#endif /* _LTT_CLUSTER_H_ */
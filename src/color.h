@@ -54,4 +54,34 @@ typedef struct {
 
 } color_rgb_t;
 
+/**
+* Datatype holding RGBW values of a color
+*
+* This extends {@link color_rgb_t} by a white component, which is output by a
+* dedicated white LED on boards having one.
+*/
+typedef struct {
+
+    /**
+     * @brief Red component of the color
+     */
+    uint8_t red;
+
+    /**
+     * @brief Green component of the color
+     */
+    uint8_t green;
+
+    /**
+     * @brief Blue component of the color
+     */
+    uint8_t blue;
+
+    /**
+     * @brief White component of the color
+     */
+    uint8_t white;
+
+} color_rgbw_t;
+
 #endif /* _LTT_COLOR_H_ */
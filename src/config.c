@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file config.c
+ *
+ * Implements the persistent configuration declared in config.h
+ *
+ * Writing to the EEPROM takes a few milliseconds per byte, which is far too
+ * long to be done from within an interrupt. Therefore config_save() only
+ * takes note that the configuration has changed, while the actual write is
+ * performed by config_update() from within the main loop. Only bytes that
+ * actually changed are written, keeping wear of the EEPROM low.
+ *
+ * @see config.h
+ */
+
+#include <avr/eeprom.h>
+
+#include "bus.h"
+#include "config.h"
+#include "protocol.h"
+#include "pwm.h"
+
+/**
+ * @brief Version of the configuration layout
+ *
+ * This needs to be changed whenever {@link config_t} is changed, so that
+ * configurations with a different layout (or an erased EEPROM) are ignored.
+ */
+#define CONFIG_VERSION 2
+
+/**
+ * Layout of the configuration within the EEPROM
+ */
+typedef struct {
+
+    /**
+     * @brief Version of the layout, see {@link #CONFIG_VERSION}
+     */
+    uint8_t version;
+
+    /**
+     * @brief Position of the pixel within the chain
+     */
+    uint8_t address;
+
+    /**
+     * @brief Mode of the PWM timers
+     */
+    uint8_t pwm_mode;
+
+    /**
+     * @brief Amount of phase groups
+     */
+    uint8_t phase_groups;
+
+    /**
+     * @brief Frame period colors are interpolated over (microseconds)
+     */
+    uint16_t frame_period;
+
+    /**
+     * @brief Mode of the link
+     */
+    uint8_t link_mode;
+
+} config_t;
+
+/**
+ * Configuration stored within the EEPROM
+ */
+static config_t EEMEM config_eeprom;
+
+/**
+ * Whether the configuration has changed and needs to be written
+ */
+static volatile uint8_t config_dirty = 0;
+
+/**
+ * Loads the configuration from the EEPROM and applies it
+ *
+ * This needs to be called after all of the involved modules have been
+ * initialized.
+ */
+void config_load()
+{
+
+    config_t config;
+
+    eeprom_read_block(&config, &config_eeprom, sizeof(config));
+
+    if (config.version != CONFIG_VERSION) {
+
+        return;
+
+    }
+
+    protocol_set_address(config.address);
+    pwm_set_mode(config.pwm_mode);
+    pwm_set_phase_alignment(config.phase_groups);
+    pwm_set_interpolation(config.frame_period);
+    bus_set_link(config.link_mode, 0);
+
+}
+
+/**
+ * Takes note that the configuration has changed
+ *
+ * @note This can be called from within interrupts.
+ *
+ * @see config_update()
+ */
+void config_save()
+{
+
+    config_dirty = 1;
+
+}
+
+/**
+ * Writes the configuration to the EEPROM if it has changed
+ *
+ * This is expected to be called periodically from within the main loop.
+ */
+void config_update()
+{
+
+    if (!config_dirty) {
+
+        return;
+
+    }
+
+    config_dirty = 0;
+
+    config_t config = {
+
+        .version = CONFIG_VERSION,
+        .address = protocol_get_address(),
+        .pwm_mode = pwm_get_mode(),
+        .phase_groups = pwm_get_phase_alignment(),
+        .frame_period = pwm_get_interpolation(),
+        .link_mode = bus_get_link_mode(),
+
+    };
+
+    eeprom_update_block(&config, &config_eeprom, sizeof(config));
+
+}
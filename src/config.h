@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file config.h
+ *
+ * Persistent configuration
+ *
+ * Settings made by the master (e.g. the {@link pwm_set_mode() PWM mode}) and
+ * the position of the pixel within the chain are stored within the EEPROM,
+ * so that a pixel comes back with the same configuration after a reset and
+ * can rejoin the bus right away.
+ *
+ * @see config.c
+ */
+
+#ifndef _LTT_CONFIG_H_
+#define _LTT_CONFIG_H_
+
+void config_load();
+
+void config_save();
+
+void config_update();
+
+#endif /* _LTT_CONFIG_H_ */
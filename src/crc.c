@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file crc.c
+ *
+ * Implements the CRC declared in crc.h
+ *
+ * @see crc.h
+ */
+
+#include "crc.h"
+
+/**
+ * Updates the given CRC with the given byte
+ *
+ * This implements a CRC-8 with the polynomial 0x07 bit by bit, which takes a
+ * constant amount of time and doesn't need a table.
+ *
+ * @param crc Current value of the CRC
+ * @param data Byte to update the CRC with
+ *
+ * @return Updated CRC
+ */
+uint8_t crc8_update(uint8_t crc, uint8_t data)
+{
+
+    crc ^= data;
+
+    for (uint8_t i = 0; i < 8; i++) {
+
+        crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+
+    }
+
+    return crc;
+
+}
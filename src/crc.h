@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file crc.h
+ *
+ * CRC protecting the frames on the bus
+ *
+ * This is shared between the firmware and the tools running on the host, so
+ * it doesn't depend on any of the hardware specific headers.
+ *
+ * @see crc.c
+ */
+
+#ifndef _LTT_CRC_H_
+#define _LTT_CRC_H_
+
+#include <inttypes.h>
+
+uint8_t crc8_update(uint8_t crc, uint8_t data);
+
+#endif /* _LTT_CRC_H_ */
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file fec.c
+ *
+ * Implements the forward error correction declared in fec.h
+ *
+ * Neither encoding nor decoding involves any loops or tables, so both take a
+ * small and constant amount of time, which allows them to be used from
+ * within the receive interrupt of the bus.
+ *
+ * @see fec.h
+ */
+
+#include "fec.h"
+
+/**
+ * Calculates the parity of the given byte
+ *
+ * @param byte Byte to calculate the parity of
+ *
+ * @return One if an odd number of bits is set, zero otherwise
+ */
+static uint8_t fec_parity(uint8_t byte)
+{
+
+    byte ^= byte >> 4;
+    byte ^= byte >> 2;
+    byte ^= byte >> 1;
+
+    return byte & 0x01;
+
+}
+
+/**
+ * Encodes the given nibble into a codeword
+ *
+ * @param nibble Nibble to encode, only the lower four bits are used
+ *
+ * @return Codeword with the layout described in fec.h
+ */
+uint8_t fec_encode(uint8_t nibble)
+{
+
+    uint8_t d0 = nibble & 0x01;
+    uint8_t d1 = (nibble >> 1) & 0x01;
+    uint8_t d2 = (nibble >> 2) & 0x01;
+    uint8_t d3 = (nibble >> 3) & 0x01;
+
+    uint8_t codeword = (d0 ^ d1 ^ d3)
+        | (d0 ^ d2 ^ d3) << 1
+        | d0 << 2
+        | (d1 ^ d2 ^ d3) << 3
+        | d1 << 4
+        | d2 << 5
+        | d3 << 6;
+
+    return codeword | fec_parity(codeword) << 7;
+
+}
+
+/**
+ * Decodes the given codeword
+ *
+ * Single bit errors are corrected. Double bit errors are detected, in which
+ * case the returned nibble is meaningless.
+ *
+ * @param codeword Received codeword
+ * @param nibble Pointer the decoded nibble is stored at
+ *
+ * @return {@link #FEC_OK}, {@link #FEC_CORRECTED} or
+ * {@link #FEC_UNCORRECTABLE}
+ */
+uint8_t fec_decode(uint8_t codeword, uint8_t* nibble)
+{
+
+    uint8_t status = FEC_OK;
+
+    // Position (1 to 7) of a single bit error, zero if there is none
+    uint8_t syndrome = fec_parity(codeword & 0x55)
+        | fec_parity(codeword & 0x66) << 1
+        | fec_parity(codeword & 0x78) << 2;
+
+    if (fec_parity(codeword)) {
+
+        // Odd number of errors, assume a single one (possibly in P0)
+        if (syndrome) {
+
+            codeword ^= 1 << (syndrome - 1);
+
+        }
+
+        status = FEC_CORRECTED;
+
+    } else if (syndrome) {
+
+        status = FEC_UNCORRECTABLE;
+
+    }
+
+    *nibble = ((codeword >> 2) & 0x01) | ((codeword >> 3) & 0x0E);
+
+    return status;
+
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file fec.h
+ *
+ * Forward error correction of frames on the bus
+ *
+ * Each nibble is encoded into a single byte with an extended Hamming(8,4)
+ * code, which corrects any single bit error and detects any double bit error
+ * within a codeword. The bits of a codeword are laid out as follows:
+ *
+ * \code
+ *  +----+----+----+----+----+----+----+----+
+ *  |  7 |  6 |  5 |  4 |  3 |  2 |  1 |  0 |
+ *  +----+----+----+----+----+----+----+----+
+ *  | P0 | D3 | D2 | D1 | P3 | D0 | P2 | P1 |
+ *  +----+----+----+----+----+----+----+----+
+ * \endcode
+ *
+ * Bits 0 to 6 correspond to the positions 1 to 7 of a classic Hamming(7,4)
+ * code, bit 7 holds the parity over all of the other bits.
+ *
+ * This is shared between the firmware and the tools running on the host, so
+ * it doesn't depend on any of the hardware specific headers.
+ *
+ * @see fec.c
+ */
+
+#ifndef _LTT_FEC_H_
+#define _LTT_FEC_H_
+
+#include <inttypes.h>
+
+/**
+ * @brief Status returned for a codeword without any errors
+ */
+#define FEC_OK 0
+
+/**
+ * @brief Status returned for a codeword with a single, corrected bit error
+ */
+#define FEC_CORRECTED 1
+
+/**
+ * @brief Status returned for a codeword with an uncorrectable error
+ */
+#define FEC_UNCORRECTABLE 2
+
+uint8_t fec_encode(uint8_t nibble);
+uint8_t fec_decode(uint8_t codeword, uint8_t* nibble);
+
+#endif /* _LTT_FEC_H_ */
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file hal.h
+ *
+ * Hardware abstraction of the supported microcontrollers
+ *
+ * Most of the peripherals used by the firmware (timer 0 and 1, `USART0`, the
+ * watchdog) are register compatible throughout the AVR family. The parts that
+ * differ are abstracted by a backend for each supported microcontroller,
+ * which is selected based upon the `-mmcu` option of the compiler:
+ *
+ * - hal_attiny841.h: ATtiny441 and ATtiny841 (the original pixel board)
+ * - hal_atmega1284p.h: ATmega1284P, which provides much more RAM
+ *
+ * Each backend defines the same set of macros and inline functions, so that
+ * none of this costs anything at runtime:
+ *
+ * - `HAL_ADC_CHANNEL_BANDGAP`, `HAL_ADC_CHANNEL_TEMPERATURE` (optional)
+ * - `HAL_SET_PULLUP(pin)`
+ * - `HAL_BUS_REMAP` if the input of the bus can be switched to the alternate
+ *   pins, see bus.h
+ * - hal_adc_select(), hal_bus_select_input()
+ * - hal_pwm_init(), hal_pwm_connect(), hal_pwm_disconnect(),
+ *   hal_pwm_set_compare_values(), hal_pwm_set_top(), hal_pwm_restart()
+ * - hal_watchdog_enable()
+ * - `HAL_TIMER_SPARE_vect`, `HAL_TIMER_SPARE_PRESCALER`,
+ *   hal_timer_spare_init(), hal_timer_spare_set() and
+ *   hal_timer_spare_count() if there is a spare timer, see bcm.h
+ *
+ * The PWM channels are spread across two 16-bit timers, the first of which
+ * is always timer 1, as its overflow interrupt drives the PWM module.
+ *
+ * @see pins.h
+ */
+
+#ifndef _LTT_HAL_H_
+#define _LTT_HAL_H_
+
+#if defined(__AVR_ATtiny441__) || defined(__AVR_ATtiny841__)
+
+    #include "hal_attiny841.h"
+
+#elif defined(__AVR_ATmega1284P__)
+
+    #include "hal_atmega1284p.h"
+
+#else
+
+    #error "Unsupported microcontroller"
+
+#endif
+
+#endif /* _LTT_HAL_H_ */
@@ -0,0 +1,273 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file hal_atmega1284p.h
+ *
+ * Hardware abstraction for the ATmega1284P
+ *
+ * Timer 3 is used for the second half of the PWM channels. The output compare
+ * pins are fixed on this device (red = `OC1A`, green = `OC1B`, blue =
+ * `OC3A`, white = `OC3B`), see pins.h.
+ *
+ * There is no internal temperature sensor, so thermal derating is not
+ * available. The pins of `USART0` can't be remapped either, so link faults
+ * are only detected and reported, but can't be bypassed.
+ *
+ * Timer 2 is spare and can be used by {@link cluster.h additional LEDs}.
+ *
+ * @note This is expected to be included by hal.h only.
+ *
+ * @see hal.h
+ */
+
+#ifndef _LTT_HAL_ATMEGA1284P_H_
+#define _LTT_HAL_ATMEGA1284P_H_
+
+#include <avr/io.h>
+
+#include "ports.h"
+#include "pwm.h"
+
+/**
+ * @brief Identifies the backend, e.g. for the pinout in pins.h
+ */
+#define HAL_ATMEGA1284P
+
+/**
+ * @brief ADC channel of the internal 1.1V bandgap reference
+ */
+#define HAL_ADC_CHANNEL_BANDGAP 0x1E
+
+/**
+ * Enables the pull-up of the given pin
+ *
+ * Pull-ups are controlled by the `PORTx` register of input pins on this
+ * device.
+ */
+#define HAL_SET_PULLUP(...) (PORT(__VA_ARGS__) |= MASK(__VA_ARGS__))
+
+/**
+ * Selects the channel and reference voltage of the ADC
+ *
+ * @param channel Value of the `MUX` bits selecting the input channel
+ * @param reference {@link #ADC_REFERENCE_VCC} or {@link #ADC_REFERENCE_1V1}
+ *
+ * @return Non-zero value if the reference voltage has been changed
+ */
+static inline uint8_t hal_adc_select(uint8_t channel, uint8_t reference)
+{
+
+    // AVCC is selected by REFS0, 1.1V by REFS1
+    uint8_t refs = reference ? _BV(REFS1) : _BV(REFS0);
+    uint8_t changed = (ADMUX & (_BV(REFS1) | _BV(REFS0))) != refs;
+
+    ADMUX = refs | channel;
+
+    return changed;
+
+}
+
+/**
+ * Switches the USART between its regular and alternate pins
+ *
+ * This device has no alternate pins, so this does nothing.
+ *
+ * @param alternate Non-zero value to use the alternate pins
+ */
+static inline void hal_bus_select_input(uint8_t alternate)
+{
+
+}
+
+/**
+ * Sets up the timers
+ *
+ * Both timers are set to mode 10 (phase correct PWM, TOP = `ICRn`) without a
+ * prescaler.
+ *
+ * @param top TOP of the timers
+ */
+static inline void hal_pwm_init(uint16_t top)
+{
+
+    // Reset compare values
+    OCR1A = 0;
+    OCR1B = 0;
+    OCR3A = 0;
+    OCR3B = 0;
+
+    // Mode 10, Phase correct PWM, Top ICRn, prescaler 1
+
+    ICR1 = top;
+    TCCR1A = _BV(WGM11);
+    TCCR1B = _BV(WGM13) | _BV(CS10);
+
+    ICR3 = top;
+    TCCR3A = _BV(WGM31);
+    TCCR3B = _BV(WGM33) | _BV(CS30);
+
+}
+
+/**
+ * Connects the output compare signals to their pins
+ *
+ * The signals are set on compare match when up-counting and cleared on
+ * compare match when down-counting, as the LEDs are active low.
+ */
+static inline void hal_pwm_connect()
+{
+
+    TCCR1A |= _BV(COM1A1) | _BV(COM1A0) | _BV(COM1B1) | _BV(COM1B0);
+    TCCR3A |= _BV(COM3A1) | _BV(COM3A0);
+
+    #ifdef PWM_RGBW
+
+        TCCR3A |= _BV(COM3B1) | _BV(COM3B0);
+
+    #endif
+
+}
+
+/**
+ * Disconnects the output compare signals from their pins
+ */
+static inline void hal_pwm_disconnect()
+{
+
+    TCCR1A &= ~(_BV(COM1A1) | _BV(COM1A0) | _BV(COM1B1) | _BV(COM1B0));
+    TCCR3A &= ~(_BV(COM3A1) | _BV(COM3A0) | _BV(COM3B1) | _BV(COM3B0));
+
+}
+
+/**
+ * Assigns the compare values of all channels
+ *
+ * @param values Compare values for each channel
+ */
+static inline void hal_pwm_set_compare_values(const uint16_t* values)
+{
+
+    OCR1A = values[PWM_CHANNEL_RED];
+    OCR1B = values[PWM_CHANNEL_GREEN];
+    OCR3A = values[PWM_CHANNEL_BLUE];
+
+    #ifdef PWM_RGBW
+
+        OCR3B = values[PWM_CHANNEL_WHITE];
+
+    #endif
+
+}
+
+/**
+ * Sets TOP of both timers
+ *
+ * @param top TOP of the timers
+ */
+static inline void hal_pwm_set_top(uint16_t top)
+{
+
+    ICR1 = top;
+    ICR3 = top;
+
+}
+
+/**
+ * Restarts both timers at BOTTOM
+ */
+static inline void hal_pwm_restart()
+{
+
+    TCNT1 = 0;
+    TCNT3 = 0;
+
+}
+
+/**
+ * @brief Interrupt of the spare timer (timer 2)
+ */
+#define HAL_TIMER_SPARE_vect TIMER2_COMPA_vect
+
+/**
+ * @brief Prescaler of the spare timer (8 microseconds per tick at 8 MHz)
+ */
+#define HAL_TIMER_SPARE_PRESCALER 64
+
+/**
+ * Starts the spare timer, which then triggers an interrupt periodically
+ *
+ * The timer is operated in CTC mode, i.e. the counter restarts at zero with
+ * each interrupt.
+ */
+static inline void hal_timer_spare_init()
+{
+
+    // CTC mode, prescaler 64
+    OCR2A = UINT8_MAX;
+    TCCR2A = _BV(WGM21);
+    TCCR2B = _BV(CS22);
+    TIMSK2 = _BV(OCIE2A);
+
+}
+
+/**
+ * Sets the interval of the spare timer
+ *
+ * The interval refers to the moment the counter restarted.
+ *
+ * @param ticks Interval between two interrupts in ticks (1 to 256)
+ */
+static inline void hal_timer_spare_set(uint16_t ticks)
+{
+
+    OCR2A = ticks - 1;
+
+}
+
+/**
+ * Returns the counter of the spare timer
+ *
+ * @return Ticks since the last interrupt
+ */
+static inline uint8_t hal_timer_spare_count()
+{
+
+    return TCNT2;
+
+}
+
+/**
+ * Enables the watchdog in interrupt and system reset mode with a timeout of
+ * 64 ms
+ *
+ * Changes to `WDTCSR` need to be announced by a timed sequence on this
+ * device.
+ *
+ * @note Interrupts need to be disabled when calling this.
+ */
+static inline void hal_watchdog_enable()
+{
+
+    WDTCSR = _BV(WDCE) | _BV(WDE);
+    WDTCSR = _BV(WDIE) | _BV(WDE) | _BV(WDP1);
+
+}
+
+#endif /* _LTT_HAL_ATMEGA1284P_H_ */
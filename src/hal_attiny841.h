@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file hal_attiny841.h
+ *
+ * Hardware abstraction for the ATtiny441 and ATtiny841
+ *
+ * Timer 2 is a 16-bit timer on these devices, so it is used for the second
+ * half of the PWM channels. The output compare signals are routed to the
+ * pins by means of the timer/counter output compare multiplexer (`TOCC`).
+ *
+ * @note This is expected to be included by hal.h only.
+ *
+ * @see hal.h
+ */
+
+#ifndef _LTT_HAL_ATTINY841_H_
+#define _LTT_HAL_ATTINY841_H_
+
+#include <avr/io.h>
+
+#include "ports.h"
+#include "pwm.h"
+
+/**
+ * @brief Identifies the backend, e.g. for the pinout in pins.h
+ */
+#define HAL_ATTINY841
+
+/**
+ * @brief Signature unlocking registers protected by the configuration change
+ * protection (`CCP`)
+ */
+#define HAL_CCP_SIGNATURE 0xD8
+
+/**
+ * @brief ADC channel of the internal 1.1V bandgap reference
+ */
+#define HAL_ADC_CHANNEL_BANDGAP 0x0D
+
+/**
+ * @brief ADC channel of the internal temperature sensor
+ */
+#define HAL_ADC_CHANNEL_TEMPERATURE 0x0C
+
+/**
+ * @brief The input of the bus can be remapped (`U0MAP`)
+ */
+#define HAL_BUS_REMAP
+
+/**
+ * Enables the pull-up of the given pin
+ *
+ * Pull-ups are controlled by separate `PUEx` registers on these devices.
+ */
+#define HAL_SET_PULLUP(...) HAL_SET_PULLUP_(__VA_ARGS__)
+
+/**
+ * Helper macro needed to implement HAL_SET_PULLUP()
+ *
+ * @param a Name of the port
+ * @param b Number of the pin
+ */
+#define HAL_SET_PULLUP_(a, b) \
+    (*((&(a) == &PORTA) ? &PUEA : &PUEB) |= _BV(b))
+
+/**
+ * Selects the channel and reference voltage of the ADC
+ *
+ * @param channel Value of the `MUX` bits selecting the input channel
+ * @param reference {@link #ADC_REFERENCE_VCC} or {@link #ADC_REFERENCE_1V1}
+ *
+ * @return Non-zero value if the reference voltage has been changed
+ */
+static inline uint8_t hal_adc_select(uint8_t channel, uint8_t reference)
+{
+
+    ADMUXA = channel;
+
+    if (ADMUXB != reference << REFS0) {
+
+        ADMUXB = reference << REFS0;
+
+        return 1;
+
+    }
+
+    return 0;
+
+}
+
+/**
+ * Switches the USART between its regular and alternate pins
+ *
+ * @note The USART needs to be disabled while calling this.
+ *
+ * @param alternate Non-zero value to use the alternate pins
+ */
+static inline void hal_bus_select_input(uint8_t alternate)
+{
+
+    if (alternate) {
+
+        REMAP |= _BV(U0MAP);
+
+    } else {
+
+        REMAP &= ~_BV(U0MAP);
+
+    }
+
+}
+
+/**
+ * Sets up the timers and routes their output compare signals
+ *
+ * Red is `OC1A` (`TOCC5`), green `OC1B` (`TOCC4`), blue `OC2A` (`TOCC3`) and
+ * white `OC2B` (`TOCC2`). Both timers are set to mode 10 (phase correct PWM,
+ * TOP = `ICRn`) without a prescaler.
+ *
+ * @param top TOP of the timers
+ */
+static inline void hal_pwm_init(uint16_t top)
+{
+
+    // Reset compare values
+    OCR1A = 0;
+    OCR1B = 0;
+    OCR2A = 0;
+    OCR2B = 0;
+
+    #ifdef PWM_RGBW
+
+        // Setup and enable TOCC channels, including OC2B for white
+        TOCPMSA0 = _BV(TOCC3S1) | _BV(TOCC2S1);
+        TOCPMSA1 = _BV(TOCC4S0) | _BV(TOCC5S0);
+        TOCPMCOE = _BV(TOCC5OE) | _BV(TOCC4OE) | _BV(TOCC3OE) | _BV(TOCC2OE);
+
+    #else
+
+        // Setup TOCC channels
+        TOCPMSA0 = _BV(TOCC3S1);
+        TOCPMSA1 = _BV(TOCC4S0) | _BV(TOCC5S0);
+
+        // Enable TOCC channels
+        TOCPMCOE = _BV(TOCC5OE) | _BV(TOCC4OE) | _BV(TOCC3OE);
+
+    #endif
+
+    // Mode 10, Phase correct PWM, Top ICRn, prescaler 1
+
+    ICR1 = top;
+    TCCR1A = _BV(WGM11);
+    TCCR1B = _BV(WGM13) | _BV(CS10);
+
+    ICR2 = top;
+    TCCR2A = _BV(WGM21);
+    TCCR2B = _BV(WGM23) | _BV(CS20);
+
+}
+
+/**
+ * Connects the output compare signals to their pins
+ *
+ * The signals are set on compare match when up-counting and cleared on
+ * compare match when down-counting, as the LEDs are active low.
+ */
+static inline void hal_pwm_connect()
+{
+
+    TCCR1A |= _BV(COM1A1) | _BV(COM1A0) | _BV(COM1B1) | _BV(COM1B0);
+    TCCR2A |= _BV(COM2A1) | _BV(COM2A0);
+
+    #ifdef PWM_RGBW
+
+        TCCR2A |= _BV(COM2B1) | _BV(COM2B0);
+
+    #endif
+
+}
+
+/**
+ * Disconnects the output compare signals from their pins
+ */
+static inline void hal_pwm_disconnect()
+{
+
+    TCCR1A &= ~(_BV(COM1A1) | _BV(COM1A0) | _BV(COM1B1) | _BV(COM1B0));
+    TCCR2A &= ~(_BV(COM2A1) | _BV(COM2A0) | _BV(COM2B1) | _BV(COM2B0));
+
+}
+
+/**
+ * Assigns the compare values of all channels
+ *
+ * @param values Compare values for each channel
+ */
+static inline void hal_pwm_set_compare_values(const uint16_t* values)
+{
+
+    OCR1A = values[PWM_CHANNEL_RED];
+    OCR1B = values[PWM_CHANNEL_GREEN];
+    OCR2A = values[PWM_CHANNEL_BLUE];
+
+    #ifdef PWM_RGBW
+
+        OCR2B = values[PWM_CHANNEL_WHITE];
+
+    #endif
+
+}
+
+/**
+ * Sets TOP of both timers
+ *
+ * @param top TOP of the timers
+ */
+static inline void hal_pwm_set_top(uint16_t top)
+{
+
+    ICR1 = top;
+    ICR2 = top;
+
+}
+
+/**
+ * Restarts both timers at BOTTOM
+ */
+static inline void hal_pwm_restart()
+{
+
+    TCNT1 = 0;
+    TCNT2 = 0;
+
+}
+
+/**
+ * Enables the watchdog in interrupt and system reset mode with a timeout of
+ * 64 ms
+ *
+ * `WDTCSR` is protected by the configuration change protection on these
+ * devices.
+ *
+ * @note Interrupts need to be disabled when calling this.
+ */
+static inline void hal_watchdog_enable()
+{
+
+    CCP = HAL_CCP_SIGNATURE;
+    WDTCSR = _BV(WDIE) | _BV(WDE) | _BV(WDP1);
+
+}
+
+#endif /* _LTT_HAL_ATTINY841_H_ */
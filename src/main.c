@@ -26,7 +26,18 @@
  * represents the main entry point, where the execution will be started.
  */
 
+#include <avr/interrupt.h>
+
+#include "adc.h"
+#include "bus.h"
+#include "clock.h"
+#include "cluster.h"
+#include "config.h"
 #include "pwm.h"
+#include "supply.h"
+#include "thermal.h"
+#include "touch.h"
+#include "watchdog.h"
 
 /**
 * @brief Main entry point to start execution at
@@ -45,8 +56,34 @@
 __attribute__((OS_main)) int main(int argc, char* argv[])
 {
 
+    watchdog_init();
+
     pwm_init();
+    cluster_init();
+    adc_init();
+    touch_init();
+    bus_init();
+    clock_init();
+
+    config_load();
+    supply_init();
+
+    sei();
+
+    pwm_enable();
+    cluster_enable();
+    watchdog_start();
+
+    while(1) {
+
+        watchdog_update();
+        touch_update();
+        pwm_update();
+        cluster_update();
+        thermal_update();
+        supply_update();
+        config_update();
 
-    while(1);
+    }
 
 }
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pins.h
+ *
+ * Pin assignments of the pixel board
+ *
+ * All of the pins used throughout the firmware are defined in this file in
+ * the form expected by the macros of ports.h, e.g. `SET_HIGH(PIN_LED_RED)`.
+ * This way the whole pinout can be reviewed (and changed) at a single place.
+ *
+ * The pinout depends on the microcontroller the board is built around, see
+ * hal.h.
+ *
+ * @see ports.h
+ */
+
+#ifndef _LTT_PINS_H_
+#define _LTT_PINS_H_
+
+#include "hal.h"
+#include "ports.h"
+
+#if defined(HAL_ATTINY841)
+
+    /**
+     * @brief Red channel of the LED (`TOCC5`, active low)
+     */
+    #define PIN_LED_RED PORTA, 6
+
+    /**
+     * @brief Green channel of the LED (`TOCC4`, active low)
+     */
+    #define PIN_LED_GREEN PORTA, 5
+
+    /**
+     * @brief Blue channel of the LED (`TOCC3`, active low)
+     */
+    #define PIN_LED_BLUE PORTA, 4
+
+    /**
+     * @brief White LED on boards with one (`TOCC2`, active low)
+     *
+     * @see PWM_RGBW
+     */
+    #define PIN_LED_WHITE PORTA, 3
+
+    /**
+     * @brief Infrared emitter used for touch detection (active high)
+     */
+    #define PIN_IR_EMITTER PORTB, 1
+
+    /**
+     * @brief Phototransistor used for touch detection (`ADC0`)
+     */
+    #define PIN_IR_SENSOR PORTA, 0
+
+    /**
+     * @brief Transmitter of the bus, connected to the downstream pixel (`TXD0`)
+     */
+    #define PIN_BUS_TX PORTA, 1
+
+    /**
+     * @brief Receiver of the bus, connected to the upstream pixel (`RXD0`)
+     */
+    #define PIN_BUS_RX PORTA, 2
+
+    /**
+     * @brief Alternate transmitter of the bus (`TXD0` remapped)
+     *
+     * This is connected to the downstream pixel, too, see bus.h.
+     */
+    #define PIN_BUS_TX_ALT PORTA, 7
+
+    /**
+     * @brief Alternate receiver of the bus (`RXD0` remapped)
+     *
+     * This is connected to the pixel two positions upstream, see bus.h.
+     */
+    #define PIN_BUS_RX_ALT PORTB, 2
+
+#elif defined(HAL_ATMEGA1284P)
+
+    /**
+     * @brief Red channel of the LED (`OC1A`, active low)
+     */
+    #define PIN_LED_RED PORTD, 5
+
+    /**
+     * @brief Green channel of the LED (`OC1B`, active low)
+     */
+    #define PIN_LED_GREEN PORTD, 4
+
+    /**
+     * @brief Blue channel of the LED (`OC3A`, active low)
+     */
+    #define PIN_LED_BLUE PORTB, 6
+
+    /**
+     * @brief White LED on boards with one (`OC3B`, active low)
+     *
+     * @see PWM_RGBW
+     */
+    #define PIN_LED_WHITE PORTB, 7
+
+    /**
+     * @brief Infrared emitter used for touch detection (active high)
+     */
+    #define PIN_IR_EMITTER PORTB, 1
+
+    /**
+     * @brief Phototransistor used for touch detection (`ADC0`)
+     */
+    #define PIN_IR_SENSOR PORTA, 0
+
+    /**
+     * @brief Transmitter of the bus, connected to the downstream pixel (`TXD0`)
+     */
+    #define PIN_BUS_TX PORTD, 1
+
+    /**
+     * @brief Receiver of the bus, connected to the upstream pixel (`RXD0`)
+     */
+    #define PIN_BUS_RX PORTD, 0
+
+    /**
+     * @brief There are no alternate pins, see hal_atmega1284p.h
+     */
+    #define PIN_BUS_TX_ALT PIN_BUS_TX
+
+    /**
+     * @brief There are no alternate pins, see hal_atmega1284p.h
+     */
+    #define PIN_BUS_RX_ALT PIN_BUS_RX
+
+    /**
+     * @brief First channel of the additional LEDs (active low)
+     *
+     * The channels of all additional LEDs follow on consecutive pins (red,
+     * green and blue for each LED), see cluster.h.
+     */
+    #define PIN_CLUSTER PORTC, 0
+
+#endif
+
+#endif /* _LTT_PINS_H_ */
@@ -51,6 +51,14 @@
  * to describe the name of the port, whereas the second one describes the pin
  * number itself.
  *
+ * Besides accessing the registers themselves, there are macros to manipulate
+ * and query a single pin, e.g. `SET_HIGH(WHATEVER)` or `IS_HIGH(WHATEVER)`.
+ * As long as the definition consists of compile-time constants (which is the
+ * case for the `PORTx` macros provided by avr-libc), each of these primitives
+ * resolves to a constant I/O address and compiles down to a single `sbi`,
+ * `cbi`, `sbic` or `sbis` instruction, making them safe to use from within
+ * interrupts and in timing critical sections without disabling interrupts.
+ *
  * Internally these macros exploit the fact that addresses of the involved
  * registers can be calculated. Normally the `PINx` register comes first and
  * is followed by the `DDRx` register, which in return is followed by the
@@ -76,6 +84,9 @@
  *
  * This implementation is a combination of ideas taken from [4] and [5].
  *
+ * Whether the macros compile down to single instructions for the supported
+ * microcontrollers can be checked with `host/ports_check.sh`.
+ *
  * @note These macros are based on a concept known as [variadic macros][3].
  *
  * [1]: http://www.atmel.com/images/doc2545.pdf
@@ -90,6 +101,8 @@
 #ifndef _LTT_PORTS_H_
 #define _LTT_PORTS_H_
 
+#include <avr/io.h>
+
 /**
  * Returns the PORT register of an appropriate definition
  *
@@ -126,7 +139,7 @@
  *
  * @see DDR()
  */
-#define DDR_(a, b) (*(&a - 1))
+#define DDR_(a, b) _SFR_MEM8(_SFR_MEM_ADDR(a) - 1)
 
 /**
  * Returns the PIN register of an appropriate definition
@@ -154,7 +167,8 @@
      *
      * @see PIN()
      */
-    #define PIN_(a, b) ((&PORTF == &(x)) ? _SFR_IO8(0x00) : (*(&a - 2)))
+    #define PIN_(a, b) (*((&PORTF == &(a)) ? &_SFR_IO8(0x00) : \
+        &_SFR_MEM8(_SFR_MEM_ADDR(a) - 2)))
 
 #else
 
@@ -166,7 +180,7 @@
      *
      * @see PIN()
      */
-    #define PIN_(a, b) (*(&a - 2))
+    #define PIN_(a, b) _SFR_MEM8(_SFR_MEM_ADDR(a) - 2)
 
 #endif
 
@@ -189,4 +203,78 @@
  */
 #define BIT_(a, b) b
 
+/**
+ * Returns the bit mask of an appropriate definition
+ *
+ * The pin number is checked at compile time, so that a definition with a pin
+ * number outside of the range 0 to 7 is rejected by the compiler rather than
+ * silently touching a neighbouring register.
+ *
+ * @return Bit mask of the given definition
+ *
+ * @see MASK_()
+ */
+#define MASK(...) MASK_(__VA_ARGS__)
+
+/**
+ * Helper macro needed to implement MASK()
+ *
+ * @param a Name of the port
+ * @param b Number of the pin
+ *
+ * @see MASK()
+ */
+#define MASK_(a, b) ((uint8_t)(sizeof(char[((b) >= 0 && (b) < 8) ? 1 : -1]) \
+    * _BV(b)))
+
+/**
+ * Configures the pin of an appropriate definition as output
+ *
+ * Compiles down to a single `sbi` instruction on the `DDRx` register.
+ */
+#define SET_OUTPUT(...) (DDR(__VA_ARGS__) |= MASK(__VA_ARGS__))
+
+/**
+ * Configures the pin of an appropriate definition as input
+ *
+ * Compiles down to a single `cbi` instruction on the `DDRx` register.
+ */
+#define SET_INPUT(...) (DDR(__VA_ARGS__) &= (uint8_t)~MASK(__VA_ARGS__))
+
+/**
+ * Drives the pin of an appropriate definition high
+ *
+ * Compiles down to a single `sbi` instruction on the `PORTx` register.
+ */
+#define SET_HIGH(...) (PORT(__VA_ARGS__) |= MASK(__VA_ARGS__))
+
+/**
+ * Drives the pin of an appropriate definition low
+ *
+ * Compiles down to a single `cbi` instruction on the `PORTx` register.
+ */
+#define SET_LOW(...) (PORT(__VA_ARGS__) &= (uint8_t)~MASK(__VA_ARGS__))
+
+/**
+ * Toggles the pin of an appropriate definition
+ *
+ * This makes use of the fact that writing a logical one to a bit within the
+ * `PINx` register toggles the corresponding bit of the `PORTx` register. It
+ * compiles down to a single `sbi` instruction on the `PINx` register.
+ *
+ * @warning Older devices (e.g. ATmega8, ATmega16, ATmega32) do not support
+ * this feature.
+ */
+#define TOGGLE(...) (PIN(__VA_ARGS__) |= MASK(__VA_ARGS__))
+
+/**
+ * Checks whether the pin of an appropriate definition is high
+ *
+ * When used as part of a condition this compiles down to a single `sbic` or
+ * `sbis` instruction on the `PINx` register.
+ *
+ * @return Non-zero value if the pin is high, zero otherwise
+ */
+#define IS_HIGH(...) (PIN(__VA_ARGS__) & MASK(__VA_ARGS__))
+
 #endif /* _LTT_PORTS_H_ */
@@ -0,0 +1,698 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file protocol.c
+ *
+ * Implements the protocol declared in protocol.h
+ *
+ * Frames are parsed by a simple state machine, which is fed with one byte at
+ * a time. Each byte is processed in a bounded amount of time, so that this
+ * can be done directly from within the receive interrupt of the bus. Commands
+ * are executed once their CRC has been received and verified.
+ *
+ * Bytes of frames with forward error correction are decoded in pairs of
+ * codewords before being fed into the state machine. The first codeword of
+ * each pair is held back until the second one has been received, so that the
+ * corrected byte can be encoded again and errors don't accumulate along the
+ * chain.
+ *
+ * This file doesn't depend on any of the hardware specific headers, so it can
+ * be built for the host, too.
+ *
+ * @see protocol.h
+ */
+
+#include "bus.h"
+#include "clock.h"
+#include "cluster.h"
+#include "color.h"
+#include "config.h"
+#include "crc.h"
+#include "fec.h"
+#include "protocol.h"
+#include "pwm.h"
+#include "stream.h"
+#include "telemetry.h"
+#include "touch.h"
+#include "watchdog.h"
+
+/**
+ * States of the parser
+ *
+ * @see protocol_state
+ */
+typedef enum {
+
+    PROTOCOL_STATE_SYNC,
+    PROTOCOL_STATE_COMMAND,
+    PROTOCOL_STATE_ADDRESS,
+    PROTOCOL_STATE_LENGTH,
+    PROTOCOL_STATE_PAYLOAD,
+    PROTOCOL_STATE_CRC,
+
+} protocol_state_t;
+
+/**
+ * Current state of the parser
+ */
+static protocol_state_t protocol_state = PROTOCOL_STATE_SYNC;
+
+/**
+ * Command of the frame currently being received
+ */
+static uint8_t protocol_command;
+
+/**
+ * Address of the frame currently being received
+ */
+static uint8_t protocol_frame_address;
+
+/**
+ * Payload length of the frame currently being received
+ */
+static uint8_t protocol_length;
+
+/**
+ * Index of the next payload byte of the frame currently being received
+ */
+static uint8_t protocol_index;
+
+/**
+ * CRC of the bytes received so far
+ */
+static uint8_t protocol_crc_in;
+
+/**
+ * CRC of the bytes forwarded so far
+ *
+ * This differs from {@link #protocol_crc_in} once the pixel modified the
+ * frame while forwarding it.
+ */
+static uint8_t protocol_crc_out;
+
+/**
+ * Payload of the frame currently being received
+ *
+ * @see PROTOCOL_PAYLOAD_MAX
+ */
+static uint8_t protocol_payload[PROTOCOL_PAYLOAD_MAX];
+
+/**
+ * Index of the payload byte our color starts at within a
+ * {@link #PROTOCOL_COMMAND_QUEUE_FRAME} frame, UINT16_MAX if there is none
+ */
+static uint16_t protocol_frame_offset;
+
+/**
+ * Our color picked from a {@link #PROTOCOL_COMMAND_QUEUE_FRAME} frame
+ */
+static uint8_t protocol_frame_color[3];
+
+/**
+ * Flag indicating whether the frame currently being received is protected by
+ * forward error correction
+ *
+ * @see PROTOCOL_SYNC_FEC
+ */
+static uint8_t protocol_fec;
+
+/**
+ * Flag indicating whether the frame currently being received contained an
+ * uncorrectable error
+ */
+static uint8_t protocol_fec_error;
+
+/**
+ * Flag indicating whether the first codeword of a byte has been received
+ *
+ * @see protocol_fec_low
+ */
+static uint8_t protocol_fec_pending;
+
+/**
+ * First codeword of the byte currently being received, which holds the lower
+ * nibble
+ */
+static uint8_t protocol_fec_low;
+
+/**
+ * Position of this pixel within the chain
+ *
+ * @see PROTOCOL_ADDRESS_UNKNOWN
+ */
+static uint8_t protocol_address = PROTOCOL_ADDRESS_UNKNOWN;
+
+/**
+ * Amount of pixels the frame currently being received has skipped
+ *
+ * While the {@link #BUS_LINK_BYPASSED alternate input} is used, frames are
+ * received from the pixel two positions upstream, so the hop counter misses
+ * the dead neighbour in between. It is counted when the hop counter is
+ * received.
+ */
+static uint8_t protocol_hops_skipped;
+
+/**
+ * Checks whether the frame currently being received is addressed to us
+ *
+ * @return Non-zero value if the frame is addressed to us, zero otherwise
+ */
+static uint8_t protocol_is_addressed()
+{
+
+    return protocol_frame_address == PROTOCOL_ADDRESS_BROADCAST
+        || (protocol_frame_address == protocol_address
+        && protocol_address != PROTOCOL_ADDRESS_UNKNOWN);
+
+}
+
+/**
+ * Checks whether the frame currently being received carries a hop counter
+ *
+ * @return Non-zero value if the first payload byte is a hop counter
+ */
+static uint8_t protocol_has_hop_counter()
+{
+
+    return protocol_command == PROTOCOL_COMMAND_COLLECT_TOUCH
+        || protocol_command == PROTOCOL_COMMAND_SYNC_CLOCK;
+
+}
+
+/**
+ * Handles a payload byte of a {@link #PROTOCOL_COMMAND_COLLECT_TOUCH} frame
+ *
+ * If the pixel is touched its bit is set within the bitmap following the hop
+ * counter.
+ *
+ * @param byte Received payload byte
+ *
+ * @return Byte to forward
+ */
+static uint8_t protocol_collect_touch(uint8_t byte)
+{
+
+    uint8_t hops = protocol_payload[0];
+
+    if (hops != UINT8_MAX && protocol_index == (hops >> 3) + 1
+        && touch_is_touched()) {
+
+        byte |= 1 << (hops & 0x07);
+
+    }
+
+    return byte;
+
+}
+
+/**
+ * Executes the command of a completely received and verified frame
+ */
+static void protocol_execute()
+{
+
+    uint8_t length = protocol_length;
+
+    if (length > PROTOCOL_PAYLOAD_MAX) {
+
+        length = PROTOCOL_PAYLOAD_MAX;
+
+    }
+
+    // Learn position from hop counter, unless there were too many hops
+    if (protocol_has_hop_counter() && length >= 1
+        && protocol_payload[0] != UINT8_MAX
+        && protocol_payload[0] != protocol_address) {
+
+        protocol_address = protocol_payload[0];
+        config_save();
+
+    }
+
+    switch (protocol_command) {
+
+        case PROTOCOL_COMMAND_SET_COLOR:
+
+            if (protocol_is_addressed() && length >= 3) {
+
+                color_rgbw_t color = {
+
+                    protocol_payload[0],
+                    protocol_payload[1],
+                    protocol_payload[2],
+                    (length >= 4) ? protocol_payload[3] : 0,
+
+                };
+
+                pwm_set_color_rgbw(&color);
+
+            }
+
+            break;
+
+        case PROTOCOL_COMMAND_SYNC_CLOCK:
+
+            if (length >= 4) {
+
+                uint16_t ticks = protocol_payload[1] | protocol_payload[2] << 8;
+                uint8_t hops = protocol_payload[0] - protocol_hops_skipped;
+                uint16_t offset = hops * BUS_HOP_DELAY;
+
+                // Each pixel holds back one codeword of the frame
+                if (protocol_fec) {
+
+                    offset += hops * BUS_BYTE_TIME;
+
+                }
+
+                clock_set(ticks, offset);
+                pwm_sync((uint32_t)ticks * CLOCK_TICK + offset, protocol_address);
+
+                telemetry_sync(protocol_payload[3]);
+
+            }
+
+            break;
+
+        case PROTOCOL_COMMAND_SET_INTERPOLATION:
+
+            if (protocol_is_addressed() && length >= 2) {
+
+                pwm_set_interpolation(protocol_payload[0]
+                    | protocol_payload[1] << 8);
+                config_save();
+
+            }
+
+            break;
+
+        case PROTOCOL_COMMAND_QUEUE_COLOR:
+
+            if (protocol_is_addressed() && length >= 5) {
+
+                color_rgb_t color = {
+
+                    protocol_payload[2],
+                    protocol_payload[3],
+                    protocol_payload[4],
+
+                };
+
+                stream_queue(protocol_payload[0] | protocol_payload[1] << 8,
+                    &color);
+
+            }
+
+            break;
+
+        case PROTOCOL_COMMAND_SET_PWM_MODE:
+
+            if (protocol_is_addressed() && length >= 1) {
+
+                pwm_set_mode(protocol_payload[0]);
+                config_save();
+
+            }
+
+            break;
+
+        case PROTOCOL_COMMAND_SET_PWM_PHASE:
+
+            if (protocol_is_addressed() && length >= 1) {
+
+                pwm_set_phase_alignment(protocol_payload[0]);
+                config_save();
+
+            }
+
+            break;
+
+        case PROTOCOL_COMMAND_SET_LINK:
+
+            if (protocol_is_addressed() && length >= 3) {
+
+                bus_set_link(protocol_payload[0],
+                    protocol_payload[1] | protocol_payload[2] << 8);
+                config_save();
+
+            }
+
+            break;
+
+        case PROTOCOL_COMMAND_SET_CLUSTER:
+
+            if (protocol_is_addressed()) {
+
+                uint8_t index = protocol_payload[0];
+
+                for (uint8_t i = 1; i + 3 <= length; i += 3) {
+
+                    color_rgb_t color = {
+
+                        protocol_payload[i],
+                        protocol_payload[i + 1],
+                        protocol_payload[i + 2],
+
+                    };
+
+                    cluster_set_color_rgb(index++, &color);
+
+                }
+
+            }
+
+            break;
+
+        case PROTOCOL_COMMAND_QUEUE_FRAME:
+
+            if (protocol_frame_offset + 3 <= protocol_length) {
+
+                color_rgb_t color = {
+
+                    protocol_frame_color[0],
+                    protocol_frame_color[1],
+                    protocol_frame_color[2],
+
+                };
+
+                stream_queue(protocol_payload[0] | protocol_payload[1] << 8,
+                    &color);
+
+            }
+
+            break;
+
+        case PROTOCOL_COMMAND_REQUEST_TELEMETRY:
+
+            if (protocol_is_addressed()) {
+
+                telemetry_request();
+
+            }
+
+            break;
+
+    }
+
+}
+
+/**
+ * Feeds a single (decoded) byte of a frame into the parser
+ *
+ * @param byte Byte of the frame following the sync byte
+ *
+ * @return Byte to forward
+ */
+static uint8_t protocol_parse(uint8_t byte)
+{
+
+    uint8_t forward = byte;
+    uint8_t value = byte;
+
+    switch (protocol_state) {
+
+        case PROTOCOL_STATE_SYNC:
+
+            return forward;
+
+        case PROTOCOL_STATE_COMMAND:
+
+            protocol_command = byte;
+            protocol_state = PROTOCOL_STATE_ADDRESS;
+
+            break;
+
+        case PROTOCOL_STATE_ADDRESS:
+
+            protocol_frame_address = byte;
+            protocol_state = PROTOCOL_STATE_LENGTH;
+
+            break;
+
+        case PROTOCOL_STATE_LENGTH:
+
+            protocol_length = byte;
+            protocol_index = 0;
+            protocol_frame_offset = UINT16_MAX;
+
+            if (protocol_command == PROTOCOL_COMMAND_QUEUE_FRAME
+                && protocol_address != PROTOCOL_ADDRESS_UNKNOWN
+                && protocol_address >= protocol_frame_address) {
+
+                protocol_frame_offset = 2
+                    + 3 * (protocol_address - protocol_frame_address);
+
+            }
+
+            protocol_state = byte ? PROTOCOL_STATE_PAYLOAD : PROTOCOL_STATE_CRC;
+
+            break;
+
+        case PROTOCOL_STATE_PAYLOAD:
+
+            if (protocol_index == 0 && protocol_has_hop_counter()) {
+
+                // Count the bypassed neighbour, too
+                protocol_hops_skipped = (byte != UINT8_MAX)
+                    && (bus_get_link_state() & BUS_LINK_BYPASSED);
+                value = byte + protocol_hops_skipped;
+
+                // Don't let the hop counter wrap around
+                forward = (value == UINT8_MAX) ? value : value + 1;
+
+            } else if (protocol_command == PROTOCOL_COMMAND_COLLECT_TOUCH) {
+
+                forward = protocol_collect_touch(byte);
+
+            }
+
+            if (protocol_index < PROTOCOL_PAYLOAD_MAX) {
+
+                protocol_payload[protocol_index] = value;
+
+            }
+
+            if (protocol_index >= protocol_frame_offset
+                && protocol_index < protocol_frame_offset + 3) {
+
+                protocol_frame_color[protocol_index - protocol_frame_offset]
+                    = byte;
+
+            }
+
+            if (++protocol_index == protocol_length) {
+
+                protocol_state = PROTOCOL_STATE_CRC;
+
+            }
+
+            break;
+
+        case PROTOCOL_STATE_CRC:
+
+            // Keep an invalid CRC invalid, but account for modifications
+            forward = byte ^ protocol_crc_in ^ protocol_crc_out;
+
+            if (protocol_fec_error) {
+
+                forward = ~protocol_crc_out;
+
+            } else if (byte == protocol_crc_in) {
+
+                watchdog_bus_activity();
+
+                if (!(protocol_command & PROTOCOL_COMMAND_REPLY)) {
+
+                    protocol_execute();
+
+                }
+
+            }
+
+            protocol_state = PROTOCOL_STATE_SYNC;
+
+            return forward;
+
+    }
+
+    protocol_crc_in = crc8_update(protocol_crc_in, byte);
+    protocol_crc_out = crc8_update(protocol_crc_out, forward);
+
+    return forward;
+
+}
+
+/**
+ * Processes a single byte received from the bus
+ *
+ * This feeds the byte into the parser and {@link bus_send() sends} the bytes
+ * to be forwarded to the downstream neighbour, which is the received byte
+ * itself unless the command modifies the frame while passing through.
+ *
+ * For frames with forward error correction nothing is forwarded for the first
+ * codeword of each byte, whereas the second codeword causes both codewords of
+ * the corrected (and possibly modified) byte to be forwarded.
+ *
+ * @note This is expected to be called from within the receive interrupt of
+ * the bus.
+ *
+ * @param byte Received byte
+ */
+void protocol_process(uint8_t byte)
+{
+
+    if (protocol_state == PROTOCOL_STATE_SYNC) {
+
+        if (byte == PROTOCOL_SYNC || byte == PROTOCOL_SYNC_FEC) {
+
+            protocol_crc_in = 0;
+            protocol_crc_out = 0;
+            protocol_fec = (byte == PROTOCOL_SYNC_FEC);
+            protocol_fec_error = 0;
+            protocol_fec_pending = 0;
+            protocol_state = PROTOCOL_STATE_COMMAND;
+
+        }
+
+        bus_send(byte);
+
+        return;
+
+    }
+
+    if (!protocol_fec) {
+
+        bus_send(protocol_parse(byte));
+
+        return;
+
+    }
+
+    if (!protocol_fec_pending) {
+
+        protocol_fec_low = byte;
+        protocol_fec_pending = 1;
+
+        return;
+
+    }
+
+    protocol_fec_pending = 0;
+
+    uint8_t low;
+    uint8_t high;
+
+    uint8_t status = fec_decode(protocol_fec_low, &low);
+    status |= fec_decode(byte, &high);
+
+    if (status & FEC_UNCORRECTABLE) {
+
+        protocol_fec_error = 1;
+
+    }
+
+    uint8_t forward = protocol_parse(high << 4 | low);
+
+    bus_send(fec_encode(forward & 0x0F));
+    bus_send(fec_encode(forward >> 4));
+
+}
+
+/**
+ * Checks whether the parser is in between frames
+ *
+ * @return Non-zero value if no frame is currently being received
+ */
+uint8_t protocol_is_idle()
+{
+
+    return protocol_state == PROTOCOL_STATE_SYNC;
+
+}
+
+/**
+ * Sends a reply towards the master
+ *
+ * The frame is put on the bus as a whole, addressed with the position of this
+ * pixel.
+ *
+ * @note Interrupts need to be disabled while calling this, so that no
+ * forwarded bytes end up in between the bytes of the frame. Furthermore the
+ * parser should be {@link protocol_is_idle() idle}, so that the frame doesn't
+ * end up in the middle of a forwarded frame.
+ *
+ * @param command Command of the reply
+ * @param payload Payload of the reply
+ * @param length Amount of payload bytes
+ */
+void protocol_send_reply(uint8_t command, const uint8_t* payload,
+    uint8_t length)
+{
+
+    uint8_t crc = crc8_update(0, command);
+    crc = crc8_update(crc, protocol_address);
+    crc = crc8_update(crc, length);
+
+    bus_send(PROTOCOL_SYNC);
+    bus_send(command);
+    bus_send(protocol_address);
+    bus_send(length);
+
+    for (uint8_t i = 0; i < length; i++) {
+
+        crc = crc8_update(crc, payload[i]);
+        bus_send(payload[i]);
+
+    }
+
+    bus_send(crc);
+
+}
+
+/**
+ * Returns the position of this pixel within the chain
+ *
+ * @return Position of the pixel or {@link #PROTOCOL_ADDRESS_UNKNOWN}
+ *
+ * @see protocol_address
+ */
+uint8_t protocol_get_address()
+{
+
+    return protocol_address;
+
+}
+
+/**
+ * Sets the position of this pixel within the chain
+ *
+ * Usually the position is learned from hop counters, this is used to restore
+ * it from the {@link config.h configuration}.
+ *
+ * @param address Position of the pixel or {@link #PROTOCOL_ADDRESS_UNKNOWN}
+ *
+ * @see protocol_address
+ */
+void protocol_set_address(uint8_t address)
+{
+
+    protocol_address = address;
+
+}
@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file protocol.h
+ *
+ * Protocol spoken on the bus
+ *
+ * Each frame has the following format:
+ *
+ * \code
+ *  +------+---------+---------+--------+------------------+-----+
+ *  | SYNC | COMMAND | ADDRESS | LENGTH | PAYLOAD (LENGTH) | CRC |
+ *  +------+---------+---------+--------+------------------+-----+
+ * \endcode
+ *
+ * `SYNC` is always {@link #PROTOCOL_SYNC}. `ADDRESS` is the position of the
+ * addressed pixel within the chain (starting with zero), or
+ * {@link #PROTOCOL_ADDRESS_BROADCAST} for frames addressed to all pixels.
+ * `CRC` is a CRC-8 (polynomial 0x07) calculated over `COMMAND`, `ADDRESS`,
+ * `LENGTH` and `PAYLOAD`.
+ *
+ * Frames are forwarded byte by byte through the whole chain, see bus.h.
+ * Some commands are modified by each pixel while passing through it, in which
+ * case the pixel recalculates the CRC accordingly. A frame received with an
+ * invalid CRC is forwarded with an invalid CRC, too.
+ *
+ * Commands with the {@link #PROTOCOL_COMMAND_REPLY} bit set are sent by the
+ * pixels towards the master and are never executed by any pixel.
+ *
+ * Some broadcast commands start their payload with a hop counter, which is
+ * incremented by each pixel while passing through it. Pixels learn their
+ * position within the chain from these hop counters.
+ *
+ * Frames starting with {@link #PROTOCOL_SYNC_FEC} instead are protected by
+ * forward error correction: Each byte following the sync byte (including the
+ * CRC) is sent as two {@link fec.h codewords}, lower nibble first. This
+ * doubles the length of a frame, so the master usually only uses it for
+ * broadcasts, which would otherwise be lost for the whole rest of the chain
+ * by a single bit error. Each pixel corrects the frame while forwarding it.
+ *
+ * @see protocol.c
+ */
+
+#ifndef _LTT_PROTOCOL_H_
+#define _LTT_PROTOCOL_H_
+
+#include <inttypes.h>
+
+/**
+ * @brief Byte marking the start of a frame
+ */
+#define PROTOCOL_SYNC 0xA5
+
+/**
+ * @brief Byte marking the start of a frame with forward error correction
+ */
+#define PROTOCOL_SYNC_FEC 0x5A
+
+/**
+ * @brief Address of frames addressed to all pixels
+ */
+#define PROTOCOL_ADDRESS_BROADCAST 0xFF
+
+/**
+ * @brief Address of a pixel that doesn't know its position yet
+ */
+#define PROTOCOL_ADDRESS_UNKNOWN 0xFF
+
+#ifndef PROTOCOL_PAYLOAD_MAX
+
+    /**
+     * @brief Maximum amount of payload bytes stored for execution
+     *
+     * Longer frames are forwarded, but only their first bytes are available
+     * to the command being executed. Microcontrollers with more RAM can
+     * raise this, e.g. to set more LEDs of a cluster at once.
+     */
+    #define PROTOCOL_PAYLOAD_MAX 8
+
+#endif
+
+/**
+ * @brief Bit marking commands sent towards the master
+ */
+#define PROTOCOL_COMMAND_REPLY 0x80
+
+/**
+ * Sets the color of the addressed pixels
+ *
+ * Payload: red, green, blue, optionally white
+ *
+ * Pixels with a white LED output the white portion of the color with it
+ * anyway, the white component adds to that. Other pixels ignore it.
+ *
+ * @see pwm_set_color_rgbw()
+ */
+#define PROTOCOL_COMMAND_SET_COLOR 0x01
+
+/**
+ * Collects the touch state of all pixels into a single frame
+ *
+ * Payload: hop counter, bitmap (one bit per pixel, LSB first)
+ *
+ * The master sends this broadcast with the hop counter and the bitmap set to
+ * zero. Each pixel takes the hop counter as its position, increments it and
+ * sets its bit within the bitmap if it is touched, so that the frame returns
+ * to the master with the touch state of the whole table and the number of
+ * pixels within the chain. The master needs to provide a bitmap large enough
+ * for all of the pixels.
+ */
+#define PROTOCOL_COMMAND_COLLECT_TOUCH 0x02
+
+/**
+ * Synchronizes the {@link clock.h clock} and the telemetry slots
+ *
+ * Payload: hop counter, time (ticks, little endian), amount of slots
+ *
+ * The time refers to the moment the master finished sending the frame. Each
+ * pixel accounts for the delay the frame experienced while being forwarded
+ * by the pixels in front of it.
+ *
+ * @see telemetry_sync()
+ */
+#define PROTOCOL_COMMAND_SYNC_CLOCK 0x03
+
+/**
+ * Requests the addressed pixels to send telemetry within their next slot
+ *
+ * Payload: none
+ *
+ * @see telemetry.h
+ */
+#define PROTOCOL_COMMAND_REQUEST_TELEMETRY 0x04
+
+/**
+ * Sets the frame period the addressed pixels interpolate colors over
+ *
+ * Payload: frame period (microseconds, little endian), zero disables
+ *
+ * @see pwm_set_interpolation()
+ */
+#define PROTOCOL_COMMAND_SET_INTERPOLATION 0x05
+
+/**
+ * Queues a color to be presented by the addressed pixels at the given time
+ *
+ * Payload: time (ticks, little endian), red, green, blue
+ *
+ * @see stream.h
+ */
+#define PROTOCOL_COMMAND_QUEUE_COLOR 0x06
+
+/**
+ * Sets the mode the PWM timers of the addressed pixels are operated in
+ *
+ * Payload: mode
+ *
+ * @see pwm_set_mode()
+ */
+#define PROTOCOL_COMMAND_SET_PWM_MODE 0x07
+
+/**
+ * Aligns the PWM phase of the addressed pixels to the synchronized clock
+ *
+ * Payload: amount of phase groups, zero disables alignment
+ *
+ * @see pwm_set_phase_alignment()
+ */
+#define PROTOCOL_COMMAND_SET_PWM_PHASE 0x08
+
+/**
+ * Sets the mode of the link of the addressed pixels
+ *
+ * Payload: mode, silence timeout (ticks, little endian, zero keeps it)
+ *
+ * Usually the master broadcasts {@link #BUS_LINK_AUTO} once, so that pixels
+ * downstream of a dead pixel can bypass it on their own.
+ *
+ * @see bus_set_link()
+ */
+#define PROTOCOL_COMMAND_SET_LINK 0x09
+
+/**
+ * Sets the colors of LEDs within the cluster of the addressed pixels
+ *
+ * Payload: index of the first LED, red, green, blue (repeated for the
+ * following LEDs)
+ *
+ * Only as many LEDs as fit into {@link #PROTOCOL_PAYLOAD_MAX} are set by a
+ * single frame.
+ *
+ * @see cluster.h
+ */
+#define PROTOCOL_COMMAND_SET_CLUSTER 0x0A
+
+/**
+ * Queues colors for a run of pixels to be presented at the given time
+ *
+ * Payload: time (ticks, little endian), red, green, blue (repeated for the
+ * following pixels)
+ *
+ * The first color is meant for the addressed pixel, the following ones for
+ * the pixels behind it. Each pixel picks its own color while the frame passes
+ * through, so a single frame can carry up to 84 colors regardless of
+ * {@link #PROTOCOL_PAYLOAD_MAX}.
+ *
+ * @see stream.h
+ */
+#define PROTOCOL_COMMAND_QUEUE_FRAME 0x0B
+
+/**
+ * Telemetry sent by a pixel within its slot
+ *
+ * Payload: see telemetry.h
+ */
+#define PROTOCOL_COMMAND_TELEMETRY (PROTOCOL_COMMAND_REPLY | 0x04)
+
+void protocol_process(uint8_t byte);
+
+uint8_t protocol_is_idle();
+
+void protocol_send_reply(uint8_t command, const uint8_t* payload,
+    uint8_t length);
+
+void protocol_set_address(uint8_t address);
+uint8_t protocol_get_address();
+
+#endif /* _LTT_PROTOCOL_H_ */
@@ -24,15 +24,64 @@
  *
  * Each channel (red, green, blue) is controlled separately and is attached
  * to a different output compare pin of the microcontroller. As each timer has
- * only two output compare pins, two timers (1 and 2) are being used
- * (red = `OC1A`, green = `OC1B`, blue = `OC2A`). These timers are 16-bit wide,
- * allowing for an accurate brightness control.
+ * only two output compare pins, two timers are being used (red = `OC1A`,
+ * green = `OC1B`, blue = `OC2A` on the ATtiny841, see hal.h for others).
+ * These timers are 16-bit wide, allowing for an accurate brightness control.
+ *
+ * Boards with an additional white LED are supported by defining
+ * {@link #PWM_RGBW}, in which case the white channel is attached to the
+ * remaining output compare pin (`OC2B`). The white portion common to all of
+ * the color channels is then extracted and output by the white LED, which is
+ * considerably more efficient than mixing it. This is done on the compare
+ * values, which are proportional to the emitted light, so that the color
+ * doesn't shift.
  *
  * A {@link #pwm_table table} with precomputed PWM compare values is being used
  * as a basis for a seemingly linear brightness progression. There are exactly
  * 256 steps (= 8 bits), making it trivial to output any {@link color_rgb_t RGB
  * color}.
  *
+ * Optionally colors can be treated as keyframes, in which case the compare
+ * values are {@link pwm_set_interpolation() interpolated} linearly from the
+ * previous color to the new one over the course of the frame period. This is
+ * done once per PWM period within the overflow interrupt of timer 1, so that
+ * the output looks smooth even if the master only sends a few frames per
+ * second.
+ *
+ * With TOP at its maximum the PWM frequency is only about 61 Hz, which shows
+ * up as banding on rolling shutter cameras. Therefore there is a
+ * {@link #PWM_MODE_CAMERA camera mode}, which reduces TOP, so that the PWM
+ * frequency is raised to several kHz. Some of the lower bits of the compare
+ * values that no longer fit are recovered by temporal dithering, i.e. the
+ * compare value is incremented in a fraction of the PWM periods, so that the
+ * average brightness gains resolution. The dithering repeats every
+ * {@link #PWM_DITHER_PERIOD eight periods}, in an order spreading the
+ * increments as evenly as possible, so the slowest flicker it introduces is
+ * still at about 490 Hz. Recovering all of the bits would take 64 periods and
+ * flicker at about 61 Hz, which is just what camera mode is meant to avoid.
+ * In exchange the lowest three bits are dropped, so camera mode resolves
+ * 13 bits rather than 16.
+ *
+ * Furthermore the PWM periods of all pixels can be
+ * {@link pwm_set_phase_alignment() aligned} to the synchronized clock, so that
+ * the timers of the whole table don't beat against each other. Whenever the
+ * clock is synchronized, the deviation of the timers from the phase expected
+ * at that time is determined and then corrected over the course of a few
+ * periods by temporarily shortening (or lengthening) TOP. TOP is never
+ * shortened below any of the compare values in effect during that period, as
+ * those would be missed by the counter and clipped to fully on. New compare
+ * values are only written at BOTTOM while TOP is shortened, so they are known
+ * before TOP is chosen. In normal mode TOP is at its maximum already, so it
+ * can't be lengthened either: Pixels with a channel at full scale don't get
+ * their phase corrected until the color is dimmed again.
+ *
+ * The expected phase is derived from the synchronized clock, which wraps
+ * around after a time that isn't a multiple of the PWM period. To keep the
+ * expected phase from jumping whenever that happens, the phase refers to a
+ * grid of periods fitting into the wrap of the clock exactly. These are
+ * slightly shorter than the actual period, so the timers continuously fall
+ * behind a little, which is what can be corrected in normal mode.
+ *
  * @see pwm.h
  */
 
@@ -40,40 +89,113 @@
 #include <avr/interrupt.h>
 #include <avr/pgmspace.h>
 
+#include "clock.h"
 #include "color.h"
+#include "hal.h"
+#include "pins.h"
 #include "pwm.h"
+#include "pwm_table.h"
+
+#ifndef PWM_WHITE_RED
+
+    /**
+     * @brief Light of the white LED relative to the red LED (1/256)
+     *
+     * This is the portion of the red channel replaced by the white channel
+     * at the same compare value, i.e. 256 if the white LED on its own matches
+     * red, green and blue at full brightness. It can be calibrated for the
+     * LEDs being used.
+     */
+    #define PWM_WHITE_RED 256
+
+#endif
+
+#ifndef PWM_WHITE_GREEN
+
+    /**
+     * @brief Light of the white LED relative to the green LED (1/256)
+     *
+     * @see PWM_WHITE_RED
+     */
+    #define PWM_WHITE_GREEN 256
+
+#endif
+
+#ifndef PWM_WHITE_BLUE
+
+    /**
+     * @brief Light of the white LED relative to the blue LED (1/256)
+     *
+     * @see PWM_WHITE_RED
+     */
+    #define PWM_WHITE_BLUE 256
+
+#endif
+
+/**
+ * @brief TOP of the timers in normal mode
+ */
+#define PWM_TOP_NORMAL UINT16_MAX
+
+/**
+ * @brief Amount of bits compare values are reduced by in camera mode
+ */
+#define PWM_CAMERA_SHIFT 6
+
+/**
+ * @brief TOP of the timers in camera mode (about 3.9 kHz at 8 MHz)
+ */
+#define PWM_TOP_CAMERA (UINT16_MAX >> PWM_CAMERA_SHIFT)
+
+/**
+ * @brief Amount of the bits lost in camera mode recovered by dithering
+ */
+#define PWM_DITHER_BITS 3
+
+/**
+ * @brief Amount of PWM periods after which the dithering repeats
+ */
+#define PWM_DITHER_PERIOD (1 << PWM_DITHER_BITS)
+
+/**
+ * @brief Length of a PWM period in microseconds for the given TOP
+ *
+ * In phase correct mode the counter counts up to TOP and back down again.
+ */
+#define PWM_PERIOD(top) (2UL * (top) / (F_CPU / 1000000UL))
+
+/**
+ * @brief Timer counts after which the synchronized clock wraps around
+ */
+#define PWM_CLOCK_WRAP (65536UL * CLOCK_TICK * (F_CPU / 1000000UL))
+
+/**
+ * @brief Maximum phase correction per PWM period in units of TOP
+ *
+ * Changing TOP changes the length of a single period, so the correction is
+ * spread over a few periods to keep this unnoticeable.
+ */
+#define PWM_PHASE_STEP(top) ((top) / 8)
 
 /**
  * Table containing precomputed values used to generate PWM signals
  *
- * This table contains 256 values, each representing a single step. The values
- * are computed in such a way that the human eye perceives the increments as
- * linear progression. This concept and the values itself are described at [1].
- *
- * [1]: https://www.mikrocontroller.net/articles/LED-Fading
- */
-static const uint16_t PROGMEM pwm_table[256] = {
-
-    0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3,
-    3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 6, 6, 6, 6, 7,
-    7, 7, 8, 8, 8, 9, 9, 10, 10, 10, 11, 11, 12, 12, 13, 13, 14, 15,
-    15, 16, 17, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29,
-    31, 32, 33, 35, 36, 38, 40, 41, 43, 45, 47, 49, 52, 54, 56, 59,
-    61, 64, 67, 70, 73, 76, 79, 83, 87, 91, 95, 99, 103, 108, 112,
-    117, 123, 128, 134, 140, 146, 152, 159, 166, 173, 181, 189, 197,
-    206, 215, 225, 235, 245, 256, 267, 279, 292, 304, 318, 332, 347,
-    362, 378, 395, 412, 431, 450, 470, 490, 512, 535, 558, 583, 609,
-    636, 664, 693, 724, 756, 790, 825, 861, 899, 939, 981, 1024, 1069,
-    1117, 1166, 1218, 1272, 1328, 1387, 1448, 1512, 1579, 1649, 1722,
-    1798, 1878, 1961, 2048, 2139, 2233, 2332, 2435, 2543, 2656, 2773,
-    2896, 3025, 3158, 3298, 3444, 3597, 3756, 3922, 4096, 4277, 4467,
-    4664, 4871, 5087, 5312, 5547, 5793, 6049, 6317, 6596, 6889, 7194,
-    7512, 7845, 8192, 8555, 8933, 9329, 9742, 10173, 10624, 11094,
-    11585, 12098, 12634, 13193, 13777, 14387, 15024, 15689, 16384,
-    17109, 17867, 18658, 19484, 20346, 21247, 22188, 23170, 24196,
-    25267, 26386, 27554, 28774, 30048, 31378, 32768, 34218, 35733,
-    37315, 38967, 40693, 42494, 44376, 46340, 48392, 50534, 52772,
-    55108, 57548, 60096, 62757, 65535,
+ * @see pwm_table.h
+ */
+static const uint16_t PROGMEM pwm_table[256] = PWM_TABLE;
+
+/**
+ * Thresholds of the dithering for each PWM period of the dither period
+ *
+ * These are the indices of the periods with their bits reversed, so that a
+ * fraction of n / 8 is output within every (8 / n)th period, rather than
+ * within n consecutive ones.
+ *
+ * @see pwm_output()
+ */
+static const uint8_t PROGMEM pwm_dither_order[PWM_DITHER_PERIOD] = {
+
+    0, 4, 2, 6, 1, 5, 3, 7,
 
 };
 
@@ -87,7 +209,215 @@ static const uint16_t PROGMEM pwm_table[256] = {
  * @see pwm_set_color_rgb()
  * @see pwm_get_color_rgb()
  */
-color_rgb_t pwm_color_rgb = {0, 0, 0};
+static volatile color_rgbw_t pwm_color = {0, 0, 0, 0};
+
+/**
+ * Sequence number of the color currently being output
+ *
+ * This is incremented with each change of {@link #pwm_color}, so that
+ * readers can detect whether they have been interrupted by a change.
+ *
+ * @see pwm_get_color_rgb()
+ */
+static volatile uint8_t pwm_color_sequence;
+
+/**
+ * Compare values currently being output for each channel
+ *
+ * These are fixed point values with eight fractional bits, so that steps
+ * smaller than a single compare value can be accumulated while interpolating.
+ */
+static uint32_t pwm_current[PWM_CHANNELS];
+
+/**
+ * Compare values the interpolation is heading towards for each channel
+ */
+static uint16_t pwm_target[PWM_CHANNELS];
+
+#ifdef PWM_RGBW
+
+/**
+ * Compare values of the color channels before the white portion has been
+ * extracted
+ *
+ * These are kept, so that the table only needs to be consulted for channels
+ * that have changed.
+ *
+ * @see pwm_extract_white()
+ */
+static uint16_t pwm_mixed[PWM_CHANNEL_WHITE];
+
+#endif
+
+/**
+ * Increment per PWM period for each channel (eight fractional bits)
+ */
+static int32_t pwm_step[PWM_CHANNELS];
+
+/**
+ * Mode the timers are currently operated in
+ *
+ * @see pwm_set_mode()
+ */
+static uint8_t pwm_mode = PWM_MODE_NORMAL;
+
+/**
+ * TOP of the timers in the current mode
+ */
+static uint16_t pwm_top = PWM_TOP_NORMAL;
+
+/**
+ * Amount of phase groups, zero if phase alignment is disabled
+ *
+ * @see pwm_set_phase_alignment()
+ */
+static uint8_t pwm_phase_groups = 0;
+
+/**
+ * Time of the last synchronization in microseconds
+ *
+ * @see pwm_sync()
+ */
+static uint32_t pwm_sync_time;
+
+/**
+ * Phase of the timers at the time of the last synchronization
+ *
+ * This is the position within the period in timer counts, counting from
+ * BOTTOM, i.e. values above TOP refer to the counter counting down.
+ *
+ * @see pwm_sync()
+ */
+static uint32_t pwm_sync_phase;
+
+/**
+ * Position of this pixel at the time of the last synchronization
+ */
+static uint8_t pwm_sync_address;
+
+/**
+ * Whether a synchronization is waiting to be evaluated by pwm_update()
+ */
+static volatile uint8_t pwm_sync_pending = 0;
+
+/**
+ * Phase correction still to be applied in timer counts
+ *
+ * Positive values mean that the timers are behind, so their period needs to
+ * be shortened. This is applied by the overflow interrupt in steps of at
+ * most {@link #PWM_PHASE_STEP}.
+ */
+static int32_t pwm_phase_correction = 0;
+
+/**
+ * Whether TOP has been modified to correct the phase
+ */
+static uint8_t pwm_phase_adjusted = 0;
+
+/**
+ * Whether TOP has been shortened below {@link #pwm_top} for the current
+ * period
+ *
+ * Compare values aren't written during such a period, but deferred to the
+ * next overflow, so that they can't exceed the shortened TOP.
+ *
+ * @see pwm_output_pending
+ */
+static uint8_t pwm_phase_shortened = 0;
+
+/**
+ * Whether writing the compare values has been deferred to the next overflow
+ */
+static uint8_t pwm_output_pending = 0;
+
+/**
+ * Highest compare value that may be in effect during the current period
+ *
+ * The timers take over new compare values at TOP, so this covers the values
+ * buffered at the last overflow as well as all of the values written since.
+ *
+ * @see pwm_adjust_phase()
+ */
+static uint16_t pwm_compare_peak = 0;
+
+/**
+ * Highest of the compare values written last
+ */
+static uint16_t pwm_compare_max = 0;
+
+/**
+ * Limits of the brightness requested by the various sources
+ *
+ * @see pwm_set_limit()
+ */
+static uint8_t pwm_limits[PWM_LIMITS] = {UINT8_MAX, UINT8_MAX};
+
+/**
+ * Effective limit of the brightness, scaling all compare values by
+ * (limit + 1) / 256
+ *
+ * This is the lowest of all of the {@link #pwm_limits limits}.
+ */
+static uint8_t pwm_limit = UINT8_MAX;
+
+/**
+ * Index of the current PWM period within the dither period
+ *
+ * This is only used in {@link #PWM_MODE_CAMERA camera mode} and only
+ * advanced by the overflow interrupt, so that it counts PWM periods no matter
+ * how often the compare values are updated in between.
+ *
+ * @see pwm_output()
+ */
+static uint8_t pwm_dither = 0;
+
+/**
+ * Frame period colors are interpolated over in microseconds
+ *
+ * @see pwm_set_interpolation()
+ */
+static uint16_t pwm_frame_period = 0;
+
+/**
+ * Amount of PWM periods per frame, zero if interpolation is disabled
+ *
+ * @see pwm_set_interpolation()
+ */
+static uint8_t pwm_interpolation_periods = 0;
+
+/**
+ * Reciprocal of {@link #pwm_interpolation_periods} (16 fractional bits)
+ *
+ * This avoids divisions when a new color is set, which would take too long to
+ * be done from within the receive interrupt of the bus.
+ */
+static uint16_t pwm_interpolation_reciprocal;
+
+/**
+ * Amount of PWM periods left until the target has been reached
+ */
+static uint8_t pwm_interpolation_remaining = 0;
+
+/**
+ * Drives all of the LED pins to their inactive level
+ *
+ * The LEDs are active low, so the pins are driven high. This only has an
+ * effect on the pins while the timers are disconnected from them.
+ */
+static inline void pwm_pins_off()
+{
+
+    SET_HIGH(PIN_LED_RED);
+    SET_HIGH(PIN_LED_GREEN);
+    SET_HIGH(PIN_LED_BLUE);
+
+    #ifdef PWM_RGBW
+
+        SET_HIGH(PIN_LED_WHITE);
+
+    #endif
+
+}
 
 /**
  * Initializes the PWM module
@@ -108,33 +438,21 @@ void pwm_init()
 {
 
     // Disable LEDs (active low)
-    PORTA |= _BV(PA6) | _BV(PA5) | _BV(PA4);
+    pwm_pins_off();
 
     // Define PWM pins as output
-    DDRA |= _BV(PA6) | _BV(PA5) | _BV(PA4);
+    SET_OUTPUT(PIN_LED_RED);
+    SET_OUTPUT(PIN_LED_GREEN);
+    SET_OUTPUT(PIN_LED_BLUE);
 
-    // Reset compare values
-    OCR1A = 0;
-    OCR1B = 0;
-    OCR2A = 0;
+    #ifdef PWM_RGBW
 
-    // Setup TOCC channels
-    TOCPMSA0 = _BV(TOCC3S1);
-    TOCPMSA1 = _BV(TOCC4S0) | _BV(TOCC5S0);
+        SET_OUTPUT(PIN_LED_WHITE);
 
-    // Enable TOCC channels
-    TOCPMCOE = _BV(TOCC5OE) | _BV(TOCC4OE) | _BV(TOCC3OE);
+    #endif
 
     // Setup timers
-    // Mode 10, Phase correct PWM, Top ICRn, prescaler 1
-
-    ICR1 = UINT16_MAX;
-    TCCR1A = _BV(WGM11);
-    TCCR1B = _BV(WGM13) | _BV(CS10);
-
-    ICR2 = UINT16_MAX;
-    TCCR2A = _BV(WGM21);
-    TCCR2B = _BV(WGM23) | _BV(CS20);
+    hal_pwm_init(PWM_TOP_NORMAL);
 
 }
 
@@ -157,12 +475,11 @@ void pwm_enable()
     cli();
 
     // Disable pins
-    PORTA |= _BV(PA6) | _BV(PA5) | _BV(PA4);
+    pwm_pins_off();
 
     // Set OCnA/OCnB on Compare Match when up-counting,
     // clear OCnA/OCnB on Compare Match when downcounting
-    TCCR1A |= _BV(COM1A1) | _BV(COM1A0) | _BV(COM1B1) | _BV(COM1B0);
-    TCCR2A |= _BV(COM2A1) | _BV(COM2A0);
+    hal_pwm_connect();
 
     // Restore global interrupt flag
     SREG = tmp;
@@ -190,11 +507,10 @@ void pwm_disable()
     cli();
 
     // Normal port operation, OCnA/OCnB disconnected
-    TCCR1A &= ~(_BV(COM1A1) | _BV(COM1A0) | _BV(COM1B1) | _BV(COM1B0));
-    TCCR2A &= ~(_BV(COM2A1) | _BV(COM2A0));
+    hal_pwm_disconnect();
 
     // Disable pins
-    PORTA |= _BV(PA6) | _BV(PA5) | _BV(PA4);
+    pwm_pins_off();
 
     // Restore global interrupt flag
     SREG = tmp;
@@ -210,21 +526,46 @@ void pwm_disable()
  * @note To make sure that the timers output their signals synchronously,
  * interrupts are shortly disabled while changing the timer settings.
  *
- * @param red Compare value for the red channel
- * @param green Compare value for the green channel
- * @param blue Compare value for the blue channel
+ * While TOP is {@link #pwm_phase_shortened shortened}, the values are only
+ * applied at the next overflow.
+ *
+ * @param values Compare values for each channel
  */
-static void pwm_set_compare_values(uint16_t red, uint16_t green, uint16_t blue)
+static void pwm_set_compare_values(const uint16_t* values)
 {
 
     // Save global interrupt flag and disable interrupts
     uint8_t tmp = SREG;
     cli();
 
-    // Assign compare values
-    OCR1A = red;
-    OCR1B = green;
-    OCR2A = blue;
+    if (pwm_phase_shortened) {
+
+        pwm_output_pending = 1;
+
+    } else {
+
+        // Assign compare values
+        hal_pwm_set_compare_values(values);
+
+        pwm_compare_max = 0;
+
+        for (uint8_t i = 0; i < PWM_CHANNELS; i++) {
+
+            if (values[i] > pwm_compare_max) {
+
+                pwm_compare_max = values[i];
+
+            }
+
+        }
+
+        if (pwm_compare_max > pwm_compare_peak) {
+
+            pwm_compare_peak = pwm_compare_max;
+
+        }
+
+    }
 
     // Restore global interrupt flag
     SREG = tmp;
@@ -232,46 +573,886 @@ static void pwm_set_compare_values(uint16_t red, uint16_t green, uint16_t blue)
 }
 
 /**
- * Sets up the timers to output a signal corresponding to the given RGB color
+ * Applies the current compare values to the timers
  *
- * This function reads in the compare values for the given arguments from the
- * precomputed {@link #pwm_table table} and applies them to the involved
- * timers. As the components of a {@link color_rgb_t RGB colors} are expected
- * to be eight bits each, and there are 256 values in the table, no further
- * transformations are needed.
+ * The values are scaled down according to the {@link #pwm_limit limit} first.
  *
- * @param color Color that PWM signal should be output for
+ * In {@link #PWM_MODE_CAMERA camera mode} the values are reduced to the lower
+ * TOP. The upper {@link #PWM_DITHER_BITS} of the bits that got lost form a
+ * fraction, which is compared against the {@link #pwm_dither_order threshold}
+ * of the current PWM period, so that the compare value is incremented in that
+ * fraction of the periods.
  *
- * @see pwm_table
- * @see pwm_color_rgb
- * @see pwm_set_compare_values()
+ * @see pwm_dither_order
+
+ * @see pwm_current
+ * @see pwm_dither
  */
-void pwm_set_color_rgb(color_rgb_t* color)
+static void pwm_output()
 {
 
-    // Save color
-    pwm_color_rgb = *color;
+    uint16_t values[PWM_CHANNELS];
+    uint8_t threshold = pgm_read_byte(&(pwm_dither_order[pwm_dither]));
+
+    for (uint8_t i = 0; i < PWM_CHANNELS; i++) {
+
+        uint16_t value = pwm_current[i] >> 8;
+
+        if (pwm_limit != UINT8_MAX) {
+
+            value = ((uint32_t)value * (pwm_limit + 1)) >> 8;
+
+        }
+
+        if (pwm_mode == PWM_MODE_CAMERA) {
+
+            uint8_t fraction = (value >> (PWM_CAMERA_SHIFT - PWM_DITHER_BITS))
+                & (PWM_DITHER_PERIOD - 1);
+
+            value >>= PWM_CAMERA_SHIFT;
+
+            if (fraction > threshold && value < PWM_TOP_CAMERA) {
+
+                value++;
 
-    // Get PWM compare values for each channel separately
-    uint16_t red_value = pgm_read_word(&(pwm_table[color->red]));
-    uint16_t green_value = pgm_read_word(&(pwm_table[color->green]));
-    uint16_t blue_value = pgm_read_word(&(pwm_table[color->blue]));
+            }
 
-    // Apply PWM compare values
-    pwm_set_compare_values(red_value, green_value, blue_value);
+        }
+
+        values[i] = value;
+
+    }
+
+    pwm_set_compare_values(values);
 
 }
 
+#ifdef PWM_RGBW
+
 /**
- * Returns the color currently being output
+ * Extracts the white portion of the given compare values
+ *
+ * The white portion is the lowest of the color channels, which is moved to
+ * the white channel and subtracted from the color channels according to the
+ * light of the white LED relative to each of them. As
+ * {@link #PWM_WHITE_RED the factors} are at most 256, the color channels
+ * can't underflow. The white channel of the given values is added on top,
+ * saturating at its maximum.
+ *
+ * @param values Compare values for each channel, the color channels still
+ * containing the white portion
+ */
+static void pwm_extract_white(uint16_t* values)
+{
+
+    uint16_t white = values[PWM_CHANNEL_RED];
+
+    if (values[PWM_CHANNEL_GREEN] < white) {
+
+        white = values[PWM_CHANNEL_GREEN];
+
+    }
+
+    if (values[PWM_CHANNEL_BLUE] < white) {
+
+        white = values[PWM_CHANNEL_BLUE];
+
+    }
+
+    values[PWM_CHANNEL_RED] -= ((uint32_t)white * PWM_WHITE_RED) >> 8;
+    values[PWM_CHANNEL_GREEN] -= ((uint32_t)white * PWM_WHITE_GREEN) >> 8;
+    values[PWM_CHANNEL_BLUE] -= ((uint32_t)white * PWM_WHITE_BLUE) >> 8;
+
+    values[PWM_CHANNEL_WHITE] = (white > UINT16_MAX - values[PWM_CHANNEL_WHITE])
+        ? UINT16_MAX : values[PWM_CHANNEL_WHITE] + white;
+
+}
+
+#endif
+
+/**
+ * Sets up the timers to output a signal corresponding to the given RGBW color
+ *
+ * This function reads in the compare values for the given arguments from the
+ * precomputed {@link #pwm_table table} and applies them to the involved
+ * timers. As the components of a {@link color_rgbw_t RGBW colors} are
+ * expected to be eight bits each, and there are 256 values in the table, no
+ * further transformations are needed.
+ *
+ * With {@link #PWM_RGBW} defined, the white portion of the color channels is
+ * {@link pwm_extract_white() extracted} in addition to the white component of
+ * the color. Otherwise the white component is ignored.
+ *
+ * Many updates repeat the color currently being output, so these only cost a
+ * comparison against a snapshot of the current color, which is taken the same
+ * way pwm_get_color_rgbw() does, i.e. without disabling interrupts. Otherwise
+ * only the compare values of the channels that actually changed are looked up.
  *
- * @return Pointer to {@link color_rgb_t color} currently being output
+ * @note The compare values are built with interrupts enabled and only
+ * committed with interrupts disabled. If the color has been changed by an
+ * interrupt in the meantime, which is detected by means of
+ * {@link #pwm_color_sequence}, the values are built again. This can be called
+ * from within interrupts as well as from the main loop.
  *
- * @see pwm_color_rgb
+ * @param color Color that PWM signal should be output for
+ *
+ * @see pwm_table
+ * @see pwm_color
+ * @see pwm_set_compare_values()
  */
-const color_rgb_t* pwm_get_color_rgb()
+void pwm_set_color_rgbw(const color_rgbw_t* color)
 {
 
-    return &pwm_color_rgb;
+    uint8_t sequence;
+    uint8_t changed;
+    uint8_t tmp;
+    uint16_t values[PWM_CHANNELS];
+
+    #ifdef PWM_RGBW
+
+        uint16_t mixed[PWM_CHANNEL_WHITE];
+
+    #endif
+
+    for (;;) {
+
+        sequence = pwm_color_sequence;
+        changed = 0;
+
+        if (color->red != pwm_color.red) {
+
+            changed |= _BV(PWM_CHANNEL_RED);
+
+        }
+
+        if (color->green != pwm_color.green) {
+
+            changed |= _BV(PWM_CHANNEL_GREEN);
+
+        }
+
+        if (color->blue != pwm_color.blue) {
+
+            changed |= _BV(PWM_CHANNEL_BLUE);
+
+        }
+
+        #ifdef PWM_RGBW
+
+            if (color->white != pwm_color.white) {
+
+                changed |= _BV(PWM_CHANNEL_WHITE);
+
+            }
+
+        #endif
+
+        if (!changed) {
+
+            if (sequence == pwm_color_sequence) {
+
+                return;
+
+            }
+
+            continue;
+
+        }
+
+        #ifdef PWM_RGBW
+
+            // Get PWM compare values of changed channels, keep the others
+            for (uint8_t i = 0; i < PWM_CHANNEL_WHITE; i++) {
+
+                mixed[i] = pwm_mixed[i];
+
+            }
+
+            if (changed & _BV(PWM_CHANNEL_RED)) {
+
+                mixed[PWM_CHANNEL_RED]
+                    = pgm_read_word(&(pwm_table[color->red]));
+
+            }
+
+            if (changed & _BV(PWM_CHANNEL_GREEN)) {
+
+                mixed[PWM_CHANNEL_GREEN]
+                    = pgm_read_word(&(pwm_table[color->green]));
+
+            }
+
+            if (changed & _BV(PWM_CHANNEL_BLUE)) {
+
+                mixed[PWM_CHANNEL_BLUE]
+                    = pgm_read_word(&(pwm_table[color->blue]));
+
+            }
+
+            values[PWM_CHANNEL_RED] = mixed[PWM_CHANNEL_RED];
+            values[PWM_CHANNEL_GREEN] = mixed[PWM_CHANNEL_GREEN];
+            values[PWM_CHANNEL_BLUE] = mixed[PWM_CHANNEL_BLUE];
+            values[PWM_CHANNEL_WHITE]
+                = pgm_read_word(&(pwm_table[color->white]));
+
+            pwm_extract_white(values);
+
+        #else
+
+            // Get PWM compare values of changed channels, keep the others
+            values[PWM_CHANNEL_RED] = (changed & _BV(PWM_CHANNEL_RED))
+                ? pgm_read_word(&(pwm_table[color->red]))
+                : pwm_target[PWM_CHANNEL_RED];
+            values[PWM_CHANNEL_GREEN] = (changed & _BV(PWM_CHANNEL_GREEN))
+                ? pgm_read_word(&(pwm_table[color->green]))
+                : pwm_target[PWM_CHANNEL_GREEN];
+            values[PWM_CHANNEL_BLUE] = (changed & _BV(PWM_CHANNEL_BLUE))
+                ? pgm_read_word(&(pwm_table[color->blue]))
+                : pwm_target[PWM_CHANNEL_BLUE];
+
+        #endif
+
+        // Save global interrupt flag and disable interrupts
+        tmp = SREG;
+        cli();
+
+        if (sequence == pwm_color_sequence) {
+
+            break;
+
+        }
+
+        // Changed in the meantime, restore global interrupt flag and retry
+        SREG = tmp;
+
+    }
+
+    #ifdef PWM_RGBW
+
+        for (uint8_t i = 0; i < PWM_CHANNEL_WHITE; i++) {
+
+            pwm_mixed[i] = mixed[i];
+
+        }
+
+    #endif
+
+    // Save color
+    pwm_color = *color;
+    pwm_color_sequence++;
+
+    for (uint8_t i = 0; i < PWM_CHANNELS; i++) {
+
+        int32_t difference = (int32_t)values[i] - (pwm_current[i] >> 8);
+
+        pwm_target[i] = values[i];
+        pwm_step[i] = (difference * pwm_interpolation_reciprocal) >> 8;
+
+        if (!pwm_interpolation_periods) {
+
+            pwm_current[i] = (uint32_t)values[i] << 8;
+
+        }
+
+    }
+
+    if (pwm_interpolation_periods) {
+
+        // Let the overflow interrupt take care of it
+        pwm_interpolation_remaining = pwm_interpolation_periods;
+        TIMSK1 |= _BV(TOIE1);
+
+    } else {
+
+        // Apply PWM compare values
+        pwm_interpolation_remaining = 0;
+        pwm_output();
+
+    }
+
+    // Restore global interrupt flag
+    SREG = tmp;
+
+}
+
+/**
+ * Sets up the timers to output a signal corresponding to the given RGB color
+ *
+ * This is the same as pwm_set_color_rgbw() with the white component set to
+ * zero.
+ *
+ * @param color Color that PWM signal should be output for
+ *
+ * @see pwm_set_color_rgbw()
+ */
+void pwm_set_color_rgb(const color_rgb_t* color)
+{
+
+    color_rgbw_t rgbw = {color->red, color->green, color->blue, 0};
+
+    pwm_set_color_rgbw(&rgbw);
+
+}
+
+/**
+ * Returns the color currently being output
+ *
+ * The color is only ever changed with interrupts disabled, so a reader within
+ * an interrupt always gets a consistent color. Other readers might be
+ * interrupted by a change while copying the color, in which case they just
+ * copy it again, so that interrupts don't need to be disabled.
+ *
+ * @param color Pointer the {@link color_rgbw_t color} currently being output
+ * is stored at
+ *
+ * @see pwm_color
+ * @see pwm_color_sequence
+ */
+void pwm_get_color_rgbw(color_rgbw_t* color)
+{
+
+    uint8_t sequence;
+
+    do {
+
+        sequence = pwm_color_sequence;
+        *color = pwm_color;
+
+    } while (sequence != pwm_color_sequence);
+
+}
+
+/**
+ * Returns the color currently being output without its white component
+ *
+ * @param color Pointer the {@link color_rgb_t color} currently being output
+ * is stored at
+ *
+ * @see pwm_get_color_rgbw()
+ */
+void pwm_get_color_rgb(color_rgb_t* color)
+{
+
+    color_rgbw_t rgbw;
+
+    pwm_get_color_rgbw(&rgbw);
+
+    color->red = rgbw.red;
+    color->green = rgbw.green;
+    color->blue = rgbw.blue;
+
+}
+
+/**
+ * Converts the frame period into PWM periods of the current mode
+ *
+ * @note Interrupts need to be disabled when calling this.
+ *
+ * @see pwm_frame_period
+ */
+static void pwm_update_interpolation()
+{
+
+    uint32_t period = (pwm_mode == PWM_MODE_CAMERA)
+        ? PWM_PERIOD(PWM_TOP_CAMERA) : PWM_PERIOD(PWM_TOP_NORMAL);
+    uint32_t periods = (pwm_frame_period + period / 2) / period;
+
+    if (periods > UINT8_MAX) {
+
+        periods = UINT8_MAX;
+
+    }
+
+    // Interpolating over a single period is the same as not interpolating
+    if (periods < 2) {
+
+        pwm_interpolation_periods = 0;
+        pwm_interpolation_reciprocal = 0;
+
+    } else {
+
+        pwm_interpolation_periods = periods;
+        pwm_interpolation_reciprocal = (1UL << 16) / periods;
+
+    }
+
+}
+
+/**
+ * Sets the frame period colors are interpolated over
+ *
+ * Once set, each color passed to pwm_set_color_rgb() is treated as keyframe
+ * and the output fades linearly from the previous color to the new one over
+ * the given period. The period should match the frame rate of the master,
+ * so that each fade completes just as the next keyframe arrives.
+ *
+ * @param period Frame period in microseconds, zero disables interpolation
+ *
+ * @see pwm_interpolation_periods
+ */
+void pwm_set_interpolation(uint16_t period)
+{
+
+    // Save global interrupt flag and disable interrupts
+    uint8_t tmp = SREG;
+    cli();
+
+    pwm_frame_period = period;
+    pwm_update_interpolation();
+
+    // Restore global interrupt flag
+    SREG = tmp;
+
+}
+
+/**
+ * Returns the frame period colors are interpolated over
+ *
+ * @return Frame period in microseconds, zero if interpolation is disabled
+ *
+ * @see pwm_frame_period
+ */
+uint16_t pwm_get_interpolation()
+{
+
+    // Save global interrupt flag and disable interrupts
+    uint8_t tmp = SREG;
+    cli();
+
+    uint16_t period = pwm_frame_period;
+
+    // Restore global interrupt flag
+    SREG = tmp;
+
+    return period;
+
+}
+
+/**
+ * Sets the mode the timers are operated in
+ *
+ * Switching the mode restarts both timers at BOTTOM, so the current PWM
+ * period is cut short. Other than that the switch is seamless, i.e. the
+ * current color and the interpolation are retained.
+ *
+ * @param mode Either {@link #PWM_MODE_NORMAL} or {@link #PWM_MODE_CAMERA}
+ */
+void pwm_set_mode(uint8_t mode)
+{
+
+    // Treat anything unknown as normal mode
+    if (mode != PWM_MODE_CAMERA) {
+
+        mode = PWM_MODE_NORMAL;
+
+    }
+
+    uint16_t top = (mode == PWM_MODE_CAMERA) ? PWM_TOP_CAMERA : PWM_TOP_NORMAL;
+
+    // Save global interrupt flag and disable interrupts
+    uint8_t tmp = SREG;
+    cli();
+
+    pwm_mode = mode;
+    pwm_top = top;
+
+    // Restart at BOTTOM first, so that the counters are below the new TOP
+    hal_pwm_restart();
+    hal_pwm_set_top(top);
+
+    // The phase is off anyway, wait for the next synchronization
+    pwm_phase_correction = 0;
+    pwm_phase_adjusted = 0;
+    pwm_phase_shortened = 0;
+    pwm_compare_peak = 0;
+
+    pwm_update_interpolation();
+    pwm_output();
+
+    // Dithering needs the overflow interrupt to run continuously
+    if (pwm_mode == PWM_MODE_CAMERA) {
+
+        TIMSK1 |= _BV(TOIE1);
+
+    }
+
+    // Restore global interrupt flag
+    SREG = tmp;
+
+}
+
+/**
+ * Returns the mode the timers are currently operated in
+ *
+ * @return Either {@link #PWM_MODE_NORMAL} or {@link #PWM_MODE_CAMERA}
+ *
+ * @see pwm_mode
+ */
+uint8_t pwm_get_mode()
+{
+
+    return pwm_mode;
+
+}
+
+/**
+ * Limits the brightness of the output
+ *
+ * All compare values are scaled down by the given limit in the linear domain,
+ * i.e. after the color has been looked up in the {@link #pwm_table table}.
+ * The color itself is retained and output again in full once the limit has
+ * been lifted. Each source sets its limit independently, the lowest one
+ * takes effect.
+ *
+ * @param source Source of the limit, e.g. {@link #PWM_LIMIT_THERMAL}
+ * @param limit Limit, ranging from 0 (off) to 255 (full brightness)
+ *
+ * @see pwm_limit
+ */
+void pwm_set_limit(uint8_t source, uint8_t limit)
+{
+
+    // Save global interrupt flag and disable interrupts
+    uint8_t tmp = SREG;
+    cli();
+
+    pwm_limits[source] = limit;
+
+    for (uint8_t i = 0; i < PWM_LIMITS; i++) {
+
+        if (pwm_limits[i] < limit) {
+
+            limit = pwm_limits[i];
+
+        }
+
+    }
+
+    if (pwm_limit != limit) {
+
+        pwm_limit = limit;
+        pwm_output();
+
+    }
+
+    // Restore global interrupt flag
+    SREG = tmp;
+
+}
+
+/**
+ * Returns the effective limit of the brightness
+ *
+ * @return Lowest of the limits of all sources
+ *
+ * @see pwm_set_limit()
+ */
+uint8_t pwm_get_limit()
+{
+
+    return pwm_limit;
+
+}
+
+/**
+ * Looks up the compare value for the given brightness
+ *
+ * This makes the {@link #pwm_table table} available to other modules
+ * driving LEDs, so that these share the same brightness progression.
+ *
+ * @param value Brightness (0 to 255)
+ *
+ * @return Compare value in the linear domain (16 bits)
+ */
+uint16_t pwm_lookup(uint8_t value)
+{
+
+    return pgm_read_word(&(pwm_table[value]));
+
+}
+
+/**
+ * Enables or disables alignment of the PWM phase to the synchronized clock
+ *
+ * With a single group all pixels output their PWM periods in phase. With
+ * multiple groups, pixels are assigned to the groups according to their
+ * position and the periods of the groups are staggered evenly, which spreads
+ * the current drawn by the table over the whole period.
+ *
+ * @param groups Amount of phase groups, zero disables alignment
+ *
+ * @see pwm_phase_groups
+ */
+void pwm_set_phase_alignment(uint8_t groups)
+{
+
+    pwm_phase_groups = groups;
+
+}
+
+/**
+ * Returns the amount of phase groups
+ *
+ * @return Amount of phase groups, zero if phase alignment is disabled
+ *
+ * @see pwm_phase_groups
+ */
+uint8_t pwm_get_phase_alignment()
+{
+
+    return pwm_phase_groups;
+
+}
+
+/**
+ * Takes note of the phase of the timers when the clock has been synchronized
+ *
+ * The actual evaluation is deferred to pwm_update(), as it involves a few
+ * divisions, which would take too long from within an interrupt.
+ *
+ * @note This is expected to be called from within an interrupt right after
+ * the clock has been synchronized.
+ *
+ * @param time Time the clock has been set to in microseconds
+ * @param address Position of this pixel
+ */
+void pwm_sync(uint32_t time, uint8_t address)
+{
+
+    if (!pwm_phase_groups) {
+
+        return;
+
+    }
+
+    // Read counter twice to determine the direction it is counting in
+    uint16_t first = TCNT1;
+    uint16_t second = TCNT1;
+
+    pwm_sync_phase = (second >= first) ? second : 2UL * pwm_top - second;
+    pwm_sync_time = time;
+    pwm_sync_address = address;
+    pwm_sync_pending = 1;
+
+}
+
+/**
+ * Evaluates the last synchronization
+ *
+ * The expected phase is derived from the time of the synchronization (plus
+ * the offset of the phase group) and compared to the actual phase of the
+ * timers. The difference is then handed over to the overflow interrupt.
+ *
+ * This is expected to be called periodically from within the main loop.
+ *
+ * @see pwm_phase_correction
+ */
+void pwm_update()
+{
+
+    if (!pwm_sync_pending) {
+
+        return;
+
+    }
+
+    // Save global interrupt flag and disable interrupts
+    uint8_t tmp = SREG;
+    cli();
+
+    uint32_t time = pwm_sync_time;
+    uint32_t phase = pwm_sync_phase;
+    uint8_t address = pwm_sync_address;
+    uint8_t groups = pwm_phase_groups;
+    uint32_t period = 2UL * pwm_top;
+    pwm_sync_pending = 0;
+
+    // Restore global interrupt flag
+    SREG = tmp;
+
+    if (!groups) {
+
+        return;
+
+    }
+
+    // Periods of the grid fitting into the wrap of the clock
+    uint32_t periods = (PWM_CLOCK_WRAP + period - 1) / period;
+
+    // Position within the wrap of the clock scaled by the amount of periods,
+    // split up into ticks, so that this fits into 32 bits
+    uint16_t ticks = time / CLOCK_TICK;
+    uint32_t position = (uint32_t)CLOCK_TICK * (uint16_t)(ticks * periods)
+        + (time % CLOCK_TICK) * periods;
+
+    position %= 65536UL * CLOCK_TICK;
+
+    // Phase within the current period of the grid in timer counts
+    uint32_t target = (position >> 8) * period / (256UL * CLOCK_TICK);
+
+    if (address != UINT8_MAX) {
+
+        target += (address % groups) * (period / groups);
+
+    }
+
+    int32_t error = (int32_t)(target % period) - (int32_t)phase;
+
+    // Take the shorter way around
+    if (error > (int32_t)(period / 2)) {
+
+        error -= period;
+
+    } else if (error <= -(int32_t)(period / 2)) {
+
+        error += period;
+
+    }
+
+    // TOP can't be raised above its maximum, so only shorten in normal mode
+    if (error < 0 && pwm_mode == PWM_MODE_NORMAL) {
+
+        error += period;
+
+    }
+
+    // Save global interrupt flag and disable interrupts
+    tmp = SREG;
+    cli();
+
+    // Shortening TOP by one shortens the period by two counts
+    pwm_phase_correction = error / 2;
+    TIMSK1 |= _BV(TOIE1);
+
+    // Restore global interrupt flag
+    SREG = tmp;
+
+}
+
+/**
+ * Applies the next step of the phase correction
+ *
+ * This modifies TOP for a single period. As it is invoked at BOTTOM, the
+ * counters are well below the new TOP, so that they can't miss it.
+ *
+ * TOP is only shortened as far as the {@link #pwm_compare_peak compare values}
+ * in effect during this period allow. If there is no room at all, the
+ * correction is postponed to one of the following periods.
+ *
+ * @note This needs to be invoked after the compare values for the period
+ * have been written.
+ *
+ * @see pwm_phase_correction
+ */
+static inline void pwm_adjust_phase()
+{
+
+    int32_t step = pwm_phase_correction;
+    int32_t limit = PWM_PHASE_STEP(pwm_top);
+
+    if (pwm_compare_peak >= pwm_top) {
+
+        limit = 0;
+
+    } else if (pwm_top - pwm_compare_peak < limit) {
+
+        limit = pwm_top - pwm_compare_peak;
+
+    }
+
+    if (step > limit) {
+
+        step = limit;
+
+    } else if (step < -PWM_PHASE_STEP(pwm_top)) {
+
+        step = -PWM_PHASE_STEP(pwm_top);
+
+    }
+
+    // Only values written from now on may be in effect during the next period
+    pwm_compare_peak = pwm_compare_max;
+
+    // Give up until the next synchronization rather than keeping the
+    // interrupt busy, as compare values at full scale stay for a while
+    if (!step) {
+
+        pwm_phase_correction = 0;
+
+    }
+
+    if (step) {
+
+        pwm_phase_correction -= step;
+
+        hal_pwm_set_top(pwm_top - step);
+        pwm_phase_adjusted = 1;
+        pwm_phase_shortened = (step > 0);
+
+    } else if (pwm_phase_adjusted) {
+
+        hal_pwm_set_top(pwm_top);
+        pwm_phase_adjusted = 0;
+
+    }
+
+}
+
+/**
+ * Advances the interpolation, dithering and phase correction by a single PWM
+ * period
+ *
+ * The overflow occurs at BOTTOM, while new compare values only take effect at
+ * TOP, so there is plenty of time to update them. Once there is nothing left
+ * to do, the interrupt disables itself, unless it is needed for dithering.
+ */
+ISR(TIMER1_OVF_vect)
+{
+
+    // A new period has begun, which TOP hasn't been shortened for (yet)
+    pwm_phase_shortened = 0;
+
+    if (pwm_mode == PWM_MODE_CAMERA) {
+
+        pwm_dither = (pwm_dither + 1) & (PWM_DITHER_PERIOD - 1);
+
+    }
+
+    if (pwm_interpolation_remaining) {
+
+        pwm_interpolation_remaining--;
+
+        for (uint8_t i = 0; i < PWM_CHANNELS; i++) {
+
+            if (pwm_interpolation_remaining) {
+
+                pwm_current[i] += pwm_step[i];
+
+            } else {
+
+                // Avoid accumulated rounding errors
+                pwm_current[i] = (uint32_t)pwm_target[i] << 8;
+
+            }
+
+        }
+
+    } else if (pwm_mode == PWM_MODE_NORMAL && !pwm_output_pending) {
+
+        pwm_adjust_phase();
+
+        if (!pwm_phase_correction && !pwm_phase_adjusted) {
+
+            TIMSK1 &= ~_BV(TOIE1);
+
+        }
+
+        return;
+
+    }
+
+    pwm_output_pending = 0;
+    pwm_output();
+    pwm_adjust_phase();
 
 }
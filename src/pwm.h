@@ -25,6 +25,10 @@
  * This module provides means to modify the PWM signal output and hence the
  * color of the attached LED.
  *
+ * Boards with an additional white LED need to be built with `PWM_RGBW`
+ * defined (e.g. `-DPWM_RGBW`), which adds a {@link #PWM_CHANNEL_WHITE white
+ * channel}.
+ *
  * @see pwm.c
  */
 
@@ -33,12 +37,95 @@
 
 #include "color.h"
 
+/**
+ * @brief Index of the red channel
+ */
+#define PWM_CHANNEL_RED 0
+
+/**
+ * @brief Index of the green channel
+ */
+#define PWM_CHANNEL_GREEN 1
+
+/**
+ * @brief Index of the blue channel
+ */
+#define PWM_CHANNEL_BLUE 2
+
+#ifdef PWM_RGBW
+
+    /**
+     * @brief Index of the white channel
+     *
+     * This is only available on boards with a white LED, see pwm.c.
+     */
+    #define PWM_CHANNEL_WHITE 3
+
+    /**
+     * @brief Amount of channels
+     */
+    #define PWM_CHANNELS 4
+
+#else
+
+    /**
+     * @brief Amount of channels
+     */
+    #define PWM_CHANNELS 3
+
+#endif
+
+/**
+ * @brief Mode with full resolution, but a PWM frequency of only about 61 Hz
+ */
+#define PWM_MODE_NORMAL 0
+
+/**
+ * @brief Mode with a PWM frequency of several kHz suitable for cameras
+ *
+ * The resolution is reduced, which is compensated by temporal dithering.
+ */
+#define PWM_MODE_CAMERA 1
+
+/**
+ * @brief Brightness limit imposed by the {@link thermal.h thermal derating}
+ */
+#define PWM_LIMIT_THERMAL 0
+
+/**
+ * @brief Brightness limit imposed by the {@link supply.h supply monitoring}
+ */
+#define PWM_LIMIT_SUPPLY 1
+
+/**
+ * @brief Amount of sources for brightness limits
+ */
+#define PWM_LIMITS 2
+
 void pwm_init();
 
 void pwm_enable();
 void pwm_disable();
 
-void pwm_set_color_rgb(color_rgb_t* color);
-const color_rgb_t* pwm_get_color_rgb();
+void pwm_set_color_rgb(const color_rgb_t* color);
+void pwm_set_color_rgbw(const color_rgbw_t* color);
+void pwm_get_color_rgb(color_rgb_t* color);
+void pwm_get_color_rgbw(color_rgbw_t* color);
+
+void pwm_set_interpolation(uint16_t period);
+uint16_t pwm_get_interpolation();
+
+void pwm_set_mode(uint8_t mode);
+uint8_t pwm_get_mode();
+
+void pwm_set_limit(uint8_t source, uint8_t limit);
+uint8_t pwm_get_limit();
+
+uint16_t pwm_lookup(uint8_t value);
+
+void pwm_set_phase_alignment(uint8_t groups);
+uint8_t pwm_get_phase_alignment();
+void pwm_sync(uint32_t time, uint8_t address);
+void pwm_update();
 
 #endif /* _LTT_PWM_H_ */
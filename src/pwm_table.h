@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pwm_table.h
+ *
+ * Precomputed PWM compare values
+ *
+ * The table contains 256 values, each representing a single step. The values
+ * are computed in such a way that the human eye perceives the increments as
+ * linear progression. This concept and the values itself are described at [1].
+ *
+ * This is shared between the firmware and the tools running on the host, so
+ * that the host can calculate the light actually output for each value.
+ *
+ * [1]: https://www.mikrocontroller.net/articles/LED-Fading
+ */
+
+#ifndef _LTT_PWM_TABLE_H_
+#define _LTT_PWM_TABLE_H_
+
+/**
+ * @brief Initializer of a table with the compare value of each step
+ */
+#define PWM_TABLE { \
+    0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3, \
+    3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 6, 6, 6, 6, 7, \
+    7, 7, 8, 8, 8, 9, 9, 10, 10, 10, 11, 11, 12, 12, 13, 13, 14, 15, \
+    15, 16, 17, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, \
+    31, 32, 33, 35, 36, 38, 40, 41, 43, 45, 47, 49, 52, 54, 56, 59, \
+    61, 64, 67, 70, 73, 76, 79, 83, 87, 91, 95, 99, 103, 108, 112, \
+    117, 123, 128, 134, 140, 146, 152, 159, 166, 173, 181, 189, 197, \
+    206, 215, 225, 235, 245, 256, 267, 279, 292, 304, 318, 332, 347, \
+    362, 378, 395, 412, 431, 450, 470, 490, 512, 535, 558, 583, 609, \
+    636, 664, 693, 724, 756, 790, 825, 861, 899, 939, 981, 1024, 1069, \
+    1117, 1166, 1218, 1272, 1328, 1387, 1448, 1512, 1579, 1649, 1722, \
+    1798, 1878, 1961, 2048, 2139, 2233, 2332, 2435, 2543, 2656, 2773, \
+    2896, 3025, 3158, 3298, 3444, 3597, 3756, 3922, 4096, 4277, 4467, \
+    4664, 4871, 5087, 5312, 5547, 5793, 6049, 6317, 6596, 6889, 7194, \
+    7512, 7845, 8192, 8555, 8933, 9329, 9742, 10173, 10624, 11094, \
+    11585, 12098, 12634, 13193, 13777, 14387, 15024, 15689, 16384, \
+    17109, 17867, 18658, 19484, 20346, 21247, 22188, 23170, 24196, \
+    25267, 26386, 27554, 28774, 30048, 31378, 32768, 34218, 35733, \
+    37315, 38967, 40693, 42494, 44376, 46340, 48392, 50534, 52772, \
+    55108, 57548, 60096, 62757, 65535 \
+}
+
+#endif /* _LTT_PWM_TABLE_H_ */
@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file stream.c
+ *
+ * Implements the playback declared in stream.h
+ *
+ * The queued colors are kept within a ring buffer. Once per tick of the
+ * {@link clock.h clock} the oldest color is checked and presented via
+ * pwm_set_color_rgb() if its time has come. Colors are expected to be queued
+ * in chronological order.
+ *
+ * Two counters keep track of problems: An overrun occurs when a color is
+ * queued while the queue is full, in which case the color is dropped. An
+ * underrun occurs when the queue has run dry and no color has been presented
+ * for longer than the interval between the last two colors, i.e. the master
+ * failed to deliver the next frame in time. Both counters saturate.
+ *
+ * @note Colors are queued from within the receive interrupt of the bus and
+ * presented from within the interrupt of the clock. As interrupts can't
+ * interrupt each other, no further locking is needed.
+ *
+ * @see stream.h
+ */
+
+#include "clock.h"
+#include "pwm.h"
+#include "stream.h"
+
+/**
+ * Entry of the queue
+ */
+typedef struct {
+
+    /**
+     * @brief Time the color should be presented at (ticks)
+     */
+    uint16_t time;
+
+    /**
+     * @brief Color to present
+     */
+    color_rgb_t color;
+
+} stream_entry_t;
+
+/**
+ * Queue of colors waiting to be presented
+ */
+static stream_entry_t stream_queue_entries[STREAM_QUEUE_SIZE];
+
+/**
+ * Index of the position the next color will be put at
+ */
+static uint8_t stream_head = 0;
+
+/**
+ * Index of the next color to be presented
+ */
+static uint8_t stream_tail = 0;
+
+/**
+ * Time the last color has been presented at
+ */
+static uint16_t stream_last_time;
+
+/**
+ * Interval between the last two colors presented, zero if unknown
+ */
+static uint16_t stream_interval = 0;
+
+/**
+ * Whether the queue has run dry, or no color has been presented yet
+ *
+ * This makes sure that each underrun is only accounted for once and that the
+ * interval isn't derived from a gap in the stream.
+ */
+static uint8_t stream_starved = 1;
+
+/**
+ * Amount of underruns that have occurred
+ */
+static uint8_t stream_underruns = 0;
+
+/**
+ * Amount of overruns that have occurred
+ */
+static uint8_t stream_overruns = 0;
+
+/**
+ * Queues a color to be presented at the given time
+ *
+ * @note This is expected to be called from within an interrupt.
+ *
+ * @param time Time the color should be presented at (ticks)
+ * @param color Color to present
+ */
+void stream_queue(uint16_t time, const color_rgb_t* color)
+{
+
+    uint8_t head = (stream_head + 1) & (STREAM_QUEUE_SIZE - 1);
+
+    if (head == stream_tail) {
+
+        if (stream_overruns != UINT8_MAX) {
+
+            stream_overruns++;
+
+        }
+
+        return;
+
+    }
+
+    stream_queue_entries[stream_head].time = time;
+    stream_queue_entries[stream_head].color = *color;
+    stream_head = head;
+
+}
+
+/**
+ * Presents the next color if its time has come
+ *
+ * @note This is expected to be called from within the interrupt of the
+ * {@link clock.h clock}.
+ */
+void stream_tick()
+{
+
+    uint16_t now = clock_now();
+
+    if (stream_head == stream_tail) {
+
+        if (stream_interval && !stream_starved
+            && (uint16_t)(now - stream_last_time) > stream_interval) {
+
+            stream_starved = 1;
+
+            if (stream_underruns != UINT8_MAX) {
+
+                stream_underruns++;
+
+            }
+
+        }
+
+        return;
+
+    }
+
+    stream_entry_t* entry = &stream_queue_entries[stream_tail];
+
+    // Compare in a way that survives the clock wrapping around
+    if ((int16_t)(now - entry->time) < 0) {
+
+        return;
+
+    }
+
+    pwm_set_color_rgb(&entry->color);
+
+    if (!stream_starved) {
+
+        stream_interval = entry->time - stream_last_time;
+
+    }
+
+    stream_last_time = entry->time;
+    stream_starved = 0;
+
+    stream_tail = (stream_tail + 1) & (STREAM_QUEUE_SIZE - 1);
+
+}
+
+/**
+ * Returns the amount of underruns that have occurred
+ *
+ * @return Amount of underruns (saturating)
+ *
+ * @see stream_underruns
+ */
+uint8_t stream_get_underruns()
+{
+
+    return stream_underruns;
+
+}
+
+/**
+ * Returns the amount of overruns that have occurred
+ *
+ * @return Amount of overruns (saturating)
+ *
+ * @see stream_overruns
+ */
+uint8_t stream_get_overruns()
+{
+
+    return stream_overruns;
+
+}
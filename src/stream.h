@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file stream.h
+ *
+ * Playback of timestamped colors
+ *
+ * Instead of setting the color right away, the master can queue colors
+ * together with the time at which they should be presented. This way the
+ * master can send frames ahead of time in bursts, while the colors are still
+ * presented at exactly the right time, independent of any jitter on the bus.
+ *
+ * @see stream.c
+ */
+
+#ifndef _LTT_STREAM_H_
+#define _LTT_STREAM_H_
+
+#include <inttypes.h>
+
+#include "color.h"
+
+/**
+ * @brief Amount of colors that can be queued, must be a power of two
+ */
+#define STREAM_QUEUE_SIZE 8
+
+void stream_queue(uint16_t time, const color_rgb_t* color);
+
+void stream_tick();
+
+uint8_t stream_get_underruns();
+uint8_t stream_get_overruns();
+
+#endif /* _LTT_STREAM_H_ */
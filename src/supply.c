@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file supply.c
+ *
+ * Implements the monitoring of the supply voltage declared in supply.h
+ *
+ * The supply voltage is measured indirectly by converting the internal 1.1V
+ * bandgap reference with VCC as reference voltage. The result is inversely
+ * proportional to the supply voltage, so all of the thresholds are converted
+ * into ADC readings at compile time, avoiding any divisions at runtime.
+ *
+ * @see supply.h
+ */
+
+#include <avr/io.h>
+
+#include "adc.h"
+#include "clock.h"
+#include "hal.h"
+#include "protocol.h"
+#include "pwm.h"
+#include "supply.h"
+#include "watchdog.h"
+
+/**
+ * @brief Converts a voltage in millivolts into the expected ADC reading
+ */
+#define SUPPLY_ADC(voltage) ((uint16_t)(1100UL * 1024 / (voltage)))
+
+/**
+ * @brief Interval between two measurements in ticks (2 ms)
+ */
+#define SUPPLY_INTERVAL (2000UL / CLOCK_TICK)
+
+/**
+ * @brief Increment of the brightness limit per measurement after a brown-out
+ */
+#define SUPPLY_RAMP_STEP 4
+
+/**
+ * @brief Amount of measurements the ramp is delayed by per position
+ */
+#define SUPPLY_RAMP_STAGGER 1
+
+/**
+ * Time of the last measurement
+ */
+static uint16_t supply_last;
+
+/**
+ * Limit imposed by the ramp after a brown-out
+ */
+static uint8_t supply_ramp = UINT8_MAX;
+
+/**
+ * Amount of measurements left until the ramp starts
+ */
+static uint16_t supply_ramp_delay = 0;
+
+/**
+ * Whether a snapshot has been taken since the voltage dropped
+ */
+static uint8_t supply_snapshot_taken = 0;
+
+/**
+ * Initializes the supply monitoring
+ *
+ * If the last reset has been caused by a brown-out, the brightness is limited
+ * and ramped up afterwards.
+ *
+ * @note This needs to be called after the
+ * {@link config_load() configuration} has been loaded, as the delay of the
+ * ramp depends on the position of the pixel.
+ */
+void supply_init()
+{
+
+    if (watchdog_get_reset_flags() & _BV(BORF)) {
+
+        uint8_t address = protocol_get_address();
+
+        supply_ramp = 0;
+
+        if (address != PROTOCOL_ADDRESS_UNKNOWN) {
+
+            supply_ramp_delay = (uint16_t)address * SUPPLY_RAMP_STAGGER;
+
+        }
+
+        pwm_set_limit(PWM_LIMIT_SUPPLY, 0);
+
+    }
+
+}
+
+/**
+ * Measures the supply voltage and updates the brightness limit
+ *
+ * This is expected to be called periodically from within the main loop.
+ */
+void supply_update()
+{
+
+    uint16_t now = clock_now();
+
+    if ((uint16_t)(now - supply_last) < SUPPLY_INTERVAL) {
+
+        return;
+
+    }
+
+    supply_last = now;
+
+    // The bandgap needs some time to settle after being selected
+    adc_read(HAL_ADC_CHANNEL_BANDGAP, ADC_REFERENCE_VCC);
+    uint16_t reading = adc_read(HAL_ADC_CHANNEL_BANDGAP, ADC_REFERENCE_VCC);
+
+    uint8_t limit;
+
+    if (reading <= SUPPLY_ADC(SUPPLY_DIM_START)) {
+
+        limit = UINT8_MAX;
+
+    } else if (reading >= SUPPLY_ADC(SUPPLY_DIM_END)) {
+
+        limit = SUPPLY_DIM_MIN;
+
+    } else {
+
+        limit = UINT8_MAX - (uint32_t)(reading - SUPPLY_ADC(SUPPLY_DIM_START))
+            * (UINT8_MAX - SUPPLY_DIM_MIN)
+            / (SUPPLY_ADC(SUPPLY_DIM_END) - SUPPLY_ADC(SUPPLY_DIM_START));
+
+    }
+
+    if (reading >= SUPPLY_ADC(SUPPLY_SNAPSHOT)) {
+
+        if (!supply_snapshot_taken) {
+
+            watchdog_take_snapshot();
+            supply_snapshot_taken = 1;
+
+        }
+
+    } else {
+
+        supply_snapshot_taken = 0;
+
+    }
+
+    // Ramp up after a brown-out
+    if (supply_ramp_delay) {
+
+        supply_ramp_delay--;
+
+    } else if (supply_ramp != UINT8_MAX) {
+
+        supply_ramp = (supply_ramp > UINT8_MAX - SUPPLY_RAMP_STEP)
+            ? UINT8_MAX : supply_ramp + SUPPLY_RAMP_STEP;
+
+    }
+
+    pwm_set_limit(PWM_LIMIT_SUPPLY, (limit < supply_ramp) ? limit : supply_ramp);
+
+}
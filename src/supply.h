@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file supply.h
+ *
+ * Monitoring of the supply voltage
+ *
+ * When the whole table shows bright colors, the supply voltage can sag far
+ * enough for the pixels to brown out. As they all restart at the same time,
+ * the resulting inrush current then easily causes the next brown-out. To
+ * prevent this, the supply voltage is monitored and the brightness is
+ * {@link pwm_set_limit() limited} pre-emptively once it droops, reducing the
+ * load before the brown-out detector kicks in.
+ *
+ * Should the pixel brown out nonetheless, a snapshot of its state is taken
+ * beforehand (see watchdog.h), and after the restart the brightness is ramped
+ * up slowly, with the start of the ramp staggered according to the position
+ * of the pixel, so that not all pixels draw their full current at once.
+ *
+ * @note The brown-out detector itself is configured by means of the fuses.
+ *
+ * @see supply.c
+ */
+
+#ifndef _LTT_SUPPLY_H_
+#define _LTT_SUPPLY_H_
+
+/**
+ * @brief Voltage in millivolts dimming starts at
+ */
+#define SUPPLY_DIM_START 4500
+
+/**
+ * @brief Voltage in millivolts dimming reaches its maximum at
+ */
+#define SUPPLY_DIM_END 4100
+
+/**
+ * @brief Brightness limit applied at and below {@link #SUPPLY_DIM_END}
+ */
+#define SUPPLY_DIM_MIN 16
+
+/**
+ * @brief Voltage in millivolts below which a snapshot is taken
+ */
+#define SUPPLY_SNAPSHOT 4000
+
+void supply_init();
+
+void supply_update();
+
+#endif /* _LTT_SUPPLY_H_ */
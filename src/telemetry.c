@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file telemetry.c
+ *
+ * Implements the telemetry declared in telemetry.h
+ *
+ * The superframe starts with the first tick after the clock has been
+ * {@link telemetry_sync() synchronized}, followed by one slot for each pixel
+ * in the order of their position. Instead of calculating the slot from the
+ * current time over and over again, a countdown is maintained, which reaches
+ * zero whenever the slot of this pixel begins.
+ *
+ * A telemetry frame is sent within the slot if it has been
+ * {@link telemetry_request() requested} by the master, or if an event has
+ * occurred, i.e. the touch state or the state of the link has changed since
+ * it has been reported last.
+ *
+ * @see telemetry.h
+ */
+
+#include "bus.h"
+#include "protocol.h"
+#include "stream.h"
+#include "telemetry.h"
+#include "thermal.h"
+#include "touch.h"
+
+/**
+ * Length of the superframe in ticks, zero if there is no slot for this pixel
+ */
+static uint16_t telemetry_superframe = 0;
+
+/**
+ * Amount of ticks until the slot of this pixel begins
+ */
+static uint16_t telemetry_countdown;
+
+/**
+ * Amount of ticks left to start transmitting within the current slot
+ *
+ * @see TELEMETRY_SLOT_WINDOW
+ */
+static uint8_t telemetry_window = 0;
+
+/**
+ * Whether the master has requested telemetry
+ */
+static uint8_t telemetry_requested = 0;
+
+/**
+ * Flags that have been reported last
+ */
+static uint8_t telemetry_reported = 0;
+
+/**
+ * Restarts the schedule after the clock has been synchronized
+ *
+ * @note This is expected to be called from within an interrupt.
+ *
+ * @param slots Amount of slots within a superframe, usually the amount of
+ * pixels within the chain
+ */
+void telemetry_sync(uint8_t slots)
+{
+
+    uint8_t address = protocol_get_address();
+
+    telemetry_window = 0;
+
+    if (address >= slots) {
+
+        telemetry_superframe = 0;
+
+        return;
+
+    }
+
+    telemetry_superframe = (uint16_t)slots * TELEMETRY_SLOT_LENGTH;
+    telemetry_countdown = (uint16_t)address * TELEMETRY_SLOT_LENGTH + 1;
+
+}
+
+/**
+ * Requests telemetry to be sent within the next slot
+ */
+void telemetry_request()
+{
+
+    telemetry_requested = 1;
+
+}
+
+/**
+ * Tries to send a telemetry frame
+ *
+ * @return Zero if the frame couldn't be sent because the bus is busy
+ */
+static uint8_t telemetry_send()
+{
+
+    if (!protocol_is_idle()) {
+
+        return 0;
+
+    }
+
+    uint8_t payload[TELEMETRY_PAYLOAD_LENGTH];
+
+    uint16_t detection = bus_get_detection_time();
+
+    payload[TELEMETRY_FLAGS] = touch_is_touched() ? TELEMETRY_FLAG_TOUCHED : 0;
+    payload[TELEMETRY_FLAGS] |= bus_get_link_state() << TELEMETRY_FLAG_LINK_SHIFT;
+    payload[TELEMETRY_UNDERRUNS] = stream_get_underruns();
+    payload[TELEMETRY_OVERRUNS] = stream_get_overruns();
+    payload[TELEMETRY_TEMPERATURE] = thermal_get_temperature();
+    payload[TELEMETRY_LINK_FAULTS] = bus_get_link_faults();
+    payload[TELEMETRY_LINK_DETECTION] = detection;
+    payload[TELEMETRY_LINK_DETECTION + 1] = detection >> 8;
+
+    if (telemetry_requested || payload[TELEMETRY_FLAGS] != telemetry_reported) {
+
+        protocol_send_reply(PROTOCOL_COMMAND_TELEMETRY, payload,
+            TELEMETRY_PAYLOAD_LENGTH);
+
+        telemetry_requested = 0;
+        telemetry_reported = payload[TELEMETRY_FLAGS];
+
+    }
+
+    return 1;
+
+}
+
+/**
+ * Advances the schedule by a single tick
+ *
+ * @note This is expected to be called from within the interrupt of the
+ * {@link clock.h clock}.
+ */
+void telemetry_tick()
+{
+
+    if (!telemetry_superframe) {
+
+        return;
+
+    }
+
+    if (--telemetry_countdown == 0) {
+
+        telemetry_countdown = telemetry_superframe;
+        telemetry_window = TELEMETRY_SLOT_WINDOW;
+
+    }
+
+    if (telemetry_window) {
+
+        telemetry_window = telemetry_send() ? 0 : telemetry_window - 1;
+
+    }
+
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file telemetry.h
+ *
+ * Telemetry and events sent towards the master
+ *
+ * As all of the pixels share the path towards the master, replies are only
+ * sent within time slots assigned to each pixel (TDMA). The slots are derived
+ * from the position of the pixel within the chain and the synchronized
+ * {@link clock.h clock}, so that no two pixels ever transmit at the same time
+ * and the worst-case latency of an event is bounded by a single superframe
+ * (number of slots times {@link #TELEMETRY_SLOT_LENGTH}).
+ *
+ * @see telemetry.c
+ */
+
+#ifndef _LTT_TELEMETRY_H_
+#define _LTT_TELEMETRY_H_
+
+#include <inttypes.h>
+
+#include "bus.h"
+#include "clock.h"
+
+/**
+ * @brief Amount of payload bytes within a telemetry frame
+ */
+#define TELEMETRY_PAYLOAD_LENGTH 7
+
+/**
+ * @brief Offset of the flags within the payload
+ */
+#define TELEMETRY_FLAGS 0
+
+/**
+ * @brief Offset of the amount of {@link stream.h stream} underruns
+ */
+#define TELEMETRY_UNDERRUNS 1
+
+/**
+ * @brief Offset of the amount of {@link stream.h stream} overruns
+ */
+#define TELEMETRY_OVERRUNS 2
+
+/**
+ * @brief Offset of the {@link thermal.h temperature} (degrees Celsius, signed)
+ */
+#define TELEMETRY_TEMPERATURE 3
+
+/**
+ * @brief Offset of the amount of link faults detected by the {@link bus.h bus}
+ */
+#define TELEMETRY_LINK_FAULTS 4
+
+/**
+ * @brief Offset of the time it took to detect the last link fault (ticks,
+ * little endian)
+ */
+#define TELEMETRY_LINK_DETECTION 5
+
+/**
+ * @brief Flag indicating that the pixel is touched
+ */
+#define TELEMETRY_FLAG_TOUCHED 0x01
+
+/**
+ * @brief Position of the {@link bus_get_link_state() link state} within the
+ * flags
+ *
+ * Changes of the link state are reported as events, just like touches.
+ */
+#define TELEMETRY_FLAG_LINK_SHIFT 1
+
+/**
+ * @brief Amount of ticks a transmission may start after a slot has begun
+ *
+ * Transmissions can be delayed while a frame sent by the master is passing
+ * through the pixel.
+ */
+#define TELEMETRY_SLOT_WINDOW 2
+
+/**
+ * @brief Length of a single slot in ticks
+ *
+ * A slot is long enough for a telemetry frame (including its framing) to be
+ * transmitted and to pass the next pixel, even if it started at the very end
+ * of the {@link #TELEMETRY_SLOT_WINDOW window}. As it is derived from the
+ * baud rate of the bus, it shrinks when the bus gets faster.
+ */
+#define TELEMETRY_SLOT_LENGTH (TELEMETRY_SLOT_WINDOW + \
+    ((TELEMETRY_PAYLOAD_LENGTH + 5) * BUS_BYTE_TIME + BUS_HOP_DELAY \
+    + CLOCK_TICK - 1) / CLOCK_TICK)
+
+void telemetry_sync(uint8_t slots);
+
+void telemetry_request();
+
+void telemetry_tick();
+
+#endif /* _LTT_TELEMETRY_H_ */
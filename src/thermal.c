@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file thermal.c
+ *
+ * Implements the thermal monitoring declared in thermal.h
+ *
+ * The temperature sensor is sampled every {@link #THERMAL_INTERVAL} ticks.
+ * Its readings are smoothed by an exponential moving average, so that noise
+ * doesn't make the brightness flicker. Between {@link #THERMAL_DERATE_START}
+ * and {@link #THERMAL_DERATE_END} the brightness
+ * {@link pwm_set_limit() limit} decreases linearly down to
+ * {@link #THERMAL_DERATE_MIN}.
+ *
+ * @see thermal.h
+ */
+
+#include "adc.h"
+#include "clock.h"
+#include "hal.h"
+#include "pwm.h"
+#include "thermal.h"
+
+/**
+ * @brief ADC reading corresponding to 0 degrees Celsius
+ *
+ * The sensor has a slope of roughly 1 LSB per degree Celsius. The offset
+ * differs from device to device, so this should be calibrated for accurate
+ * readings.
+ */
+#define THERMAL_ADC_OFFSET 275
+
+/**
+ * @brief Interval between two samples in ticks (100 ms)
+ */
+#define THERMAL_INTERVAL (100000UL / CLOCK_TICK)
+
+/**
+ * @brief Weight of older samples within the moving average (power of two)
+ */
+#define THERMAL_FILTER_SHIFT 3
+
+/**
+ * Time of the last sample
+ */
+static uint16_t thermal_last;
+
+/**
+ * Smoothed temperature in degrees Celsius (with
+ * {@link #THERMAL_FILTER_SHIFT} fractional bits)
+ */
+static int16_t thermal_filtered = 25 << THERMAL_FILTER_SHIFT;
+
+/**
+ * Smoothed temperature in degrees Celsius, limited to the range of `int8_t`
+ *
+ * This is published by thermal_update() for thermal_get_temperature(), which
+ * is called from within interrupts. A single byte is read atomically, so
+ * unlike {@link #thermal_filtered} it can't be read while half of it has been
+ * updated.
+ */
+static volatile int8_t thermal_temperature = 25;
+
+/**
+ * Samples the temperature sensor
+ *
+ * On microcontrollers without a {@link #HAL_ADC_CHANNEL_TEMPERATURE
+ * temperature sensor} the smoothed temperature is returned as is, so that
+ * the brightness is never derated.
+ *
+ * @return Temperature in degrees Celsius
+ */
+static int16_t thermal_read()
+{
+
+    #ifdef HAL_ADC_CHANNEL_TEMPERATURE
+
+        return (int16_t)adc_read(HAL_ADC_CHANNEL_TEMPERATURE, ADC_REFERENCE_1V1)
+            - THERMAL_ADC_OFFSET;
+
+    #else
+
+        return thermal_filtered >> THERMAL_FILTER_SHIFT;
+
+    #endif
+
+}
+
+/**
+ * Samples the temperature and updates the derating
+ *
+ * This is expected to be called periodically from within the main loop.
+ */
+void thermal_update()
+{
+
+    uint16_t now = clock_now();
+
+    if ((uint16_t)(now - thermal_last) < THERMAL_INTERVAL) {
+
+        return;
+
+    }
+
+    thermal_last = now;
+
+    thermal_filtered += thermal_read()
+        - (thermal_filtered >> THERMAL_FILTER_SHIFT);
+
+    int16_t temperature = thermal_filtered >> THERMAL_FILTER_SHIFT;
+    uint8_t limit;
+
+    if (temperature > INT8_MAX) {
+
+        thermal_temperature = INT8_MAX;
+
+    } else if (temperature < INT8_MIN) {
+
+        thermal_temperature = INT8_MIN;
+
+    } else {
+
+        thermal_temperature = temperature;
+
+    }
+
+    if (temperature <= THERMAL_DERATE_START) {
+
+        limit = UINT8_MAX;
+
+    } else if (temperature >= THERMAL_DERATE_END) {
+
+        limit = THERMAL_DERATE_MIN;
+
+    } else {
+
+        limit = UINT8_MAX - (uint16_t)(temperature - THERMAL_DERATE_START)
+            * (UINT8_MAX - THERMAL_DERATE_MIN)
+            / (THERMAL_DERATE_END - THERMAL_DERATE_START);
+
+    }
+
+    pwm_set_limit(PWM_LIMIT_THERMAL, limit);
+
+}
+
+/**
+ * Returns the smoothed temperature
+ *
+ * This can be called from within interrupts as well as from the main loop.
+ *
+ * @return Temperature in degrees Celsius
+ *
+ * @see thermal_temperature
+ */
+int8_t thermal_get_temperature()
+{
+
+    return thermal_temperature;
+
+}
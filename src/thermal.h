@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file thermal.h
+ *
+ * Thermal monitoring and derating
+ *
+ * The temperature of the pixel is monitored by means of the temperature
+ * sensor built into the microcontroller. Once it exceeds a certain
+ * temperature, the brightness of the LED is reduced gradually, so that
+ * pixels that can't get rid of their heat (e.g. in enclosed corners) protect
+ * themselves, while all of the others can still run at full brightness.
+ *
+ * @see thermal.c
+ */
+
+#ifndef _LTT_THERMAL_H_
+#define _LTT_THERMAL_H_
+
+#include <inttypes.h>
+
+/**
+ * @brief Temperature in degrees Celsius derating starts at
+ */
+#define THERMAL_DERATE_START 60
+
+/**
+ * @brief Temperature in degrees Celsius derating reaches its maximum at
+ */
+#define THERMAL_DERATE_END 85
+
+/**
+ * @brief Brightness limit applied at and above {@link #THERMAL_DERATE_END}
+ */
+#define THERMAL_DERATE_MIN 64
+
+void thermal_update();
+
+int8_t thermal_get_temperature();
+
+#endif /* _LTT_THERMAL_H_ */
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file touch.c
+ *
+ * Implements the touch detection declared in touch.h
+ *
+ * The phototransistor is sampled twice: Once with the infrared emitter turned
+ * off, measuring the ambient light, and once with the emitter turned on. Only
+ * the difference between these two samples is taken into account, so that
+ * ambient light (and the light of the LED itself) is cancelled out.
+ *
+ * A hysteresis is applied to the difference, so that the state does not
+ * bounce around when the difference is close to the threshold.
+ *
+ * @see touch.h
+ */
+
+#include <avr/io.h>
+#include <util/delay.h>
+
+#include "adc.h"
+#include "pins.h"
+#include "touch.h"
+
+/**
+ * @brief ADC channel the phototransistor is attached to
+ */
+#define TOUCH_ADC_CHANNEL 0
+
+/**
+ * @brief Time in microseconds the phototransistor needs to settle
+ */
+#define TOUCH_SETTLE_TIME 50
+
+/**
+ * @brief Difference above which the pixel is considered to be touched
+ */
+#define TOUCH_THRESHOLD_ON 60
+
+/**
+ * @brief Difference below which the pixel is considered to be released
+ */
+#define TOUCH_THRESHOLD_OFF 40
+
+/**
+ * Current touch state
+ *
+ * This is updated by touch_update() and is read from within interrupts, e.g.
+ * while forwarding frames, hence it is declared volatile.
+ *
+ * @see touch_is_touched()
+ */
+static volatile uint8_t touch_touched = 0;
+
+/**
+ * Initializes the touch module
+ *
+ * @note The ADC needs to be {@link adc_init() initialized} separately.
+ */
+void touch_init()
+{
+
+    // Disable emitter and define it as output
+    SET_LOW(PIN_IR_EMITTER);
+    SET_OUTPUT(PIN_IR_EMITTER);
+
+    // Disable digital input buffer of the analog input
+    DIDR0 |= _BV(ADC0D);
+
+}
+
+/**
+ * Performs a measurement and updates the touch state
+ *
+ * This is expected to be called periodically from within the main loop.
+ *
+ * @see touch_touched
+ */
+void touch_update()
+{
+
+    // Measure ambient light
+    uint16_t ambient = adc_read(TOUCH_ADC_CHANNEL, ADC_REFERENCE_VCC);
+
+    // Measure with the emitter turned on
+    SET_HIGH(PIN_IR_EMITTER);
+    _delay_us(TOUCH_SETTLE_TIME);
+    uint16_t reflected = adc_read(TOUCH_ADC_CHANNEL, ADC_REFERENCE_VCC);
+    SET_LOW(PIN_IR_EMITTER);
+
+    uint16_t difference = (reflected > ambient) ? reflected - ambient : 0;
+
+    if (touch_touched) {
+
+        touch_touched = (difference > TOUCH_THRESHOLD_OFF);
+
+    } else {
+
+        touch_touched = (difference > TOUCH_THRESHOLD_ON);
+
+    }
+
+}
+
+/**
+ * Returns whether the pixel is currently being touched
+ *
+ * @return Non-zero value if the pixel is touched, zero otherwise
+ *
+ * @see touch_touched
+ */
+uint8_t touch_is_touched()
+{
+
+    return touch_touched;
+
+}
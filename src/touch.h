@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file touch.h
+ *
+ * Functionality for detecting touches on top of the pixel
+ *
+ * Each pixel is equipped with an infrared emitter and an infrared sensitive
+ * phototransistor. A finger (or any other object) placed on top of the pixel
+ * reflects the emitted light back onto the phototransistor.
+ *
+ * @see touch.c
+ */
+
+#ifndef _LTT_TOUCH_H_
+#define _LTT_TOUCH_H_
+
+#include <inttypes.h>
+
+void touch_init();
+
+void touch_update();
+
+uint8_t touch_is_touched();
+
+#endif /* _LTT_TOUCH_H_ */
@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file watchdog.c
+ *
+ * Implements the supervision declared in watchdog.h
+ *
+ * The watchdog is operated in the combined interrupt and system reset mode:
+ * When it times out for the first time, an interrupt is triggered, which
+ * takes a snapshot of the current color and disables the outputs. If it
+ * times out once again, the microcontroller is reset. The hardware clears
+ * the interrupt enable bit when the interrupt is triggered, so if the main
+ * loop recovers in time, the interrupt is enabled again and the outputs are
+ * restored (unless the bus is inactive).
+ *
+ * The watchdog is only reset from within the main loop, and only if the
+ * {@link clock.h clock} has advanced since then. This way it catches a hung
+ * main loop as well as interrupts that stopped firing (or never return).
+ *
+ * The snapshot is placed in the `.noinit` section, so that it isn't cleared
+ * by the startup code. It is only used after a reset caused by the watchdog
+ * or a brown-out (see supply.h), and only if its checksum matches, as the
+ * contents of the SRAM aren't guaranteed to survive a brown-out.
+ *
+ * @see watchdog.h
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/wdt.h>
+
+#include "clock.h"
+#include "cluster.h"
+#include "color.h"
+#include "hal.h"
+#include "pwm.h"
+#include "watchdog.h"
+
+/**
+ * @brief Value marking the snapshot as valid
+ */
+#define WATCHDOG_SNAPSHOT_MAGIC 0x5A
+
+/**
+ * State surviving a reset caused by the watchdog or a brown-out
+ */
+typedef struct {
+
+    /**
+     * @brief {@link #WATCHDOG_SNAPSHOT_MAGIC} if the snapshot is valid
+     */
+    uint8_t magic;
+
+    /**
+     * @brief Color that has been output
+     */
+    color_rgbw_t color;
+
+    /**
+     * @brief Checksum over the color
+     */
+    uint8_t checksum;
+
+} watchdog_snapshot_t;
+
+/**
+ * Snapshot taken before the microcontroller is reset
+ *
+ * @see watchdog_take_snapshot()
+ */
+static watchdog_snapshot_t watchdog_snapshot __attribute__((section(".noinit")));
+
+/**
+ * Contents of `MCUSR` at the time of the reset
+ */
+static uint8_t watchdog_reset_flags;
+
+/**
+ * Whether a valid frame has been received since the last update
+ *
+ * @see watchdog_bus_activity()
+ */
+static volatile uint8_t watchdog_bus_active = 0;
+
+/**
+ * Time the bus has been active the last time
+ */
+static uint16_t watchdog_last_activity;
+
+/**
+ * Time the watchdog has been reset the last time
+ */
+static uint16_t watchdog_last_reset;
+
+/**
+ * Whether the safe state has been entered due to an inactive bus
+ */
+static uint8_t watchdog_safe = 0;
+
+/**
+ * Whether the interrupt has been triggered since the last reset of the
+ * watchdog
+ */
+static volatile uint8_t watchdog_fired = 0;
+
+/**
+ * Calculates the checksum of the given color
+ *
+ * @param color Color to calculate the checksum of
+ *
+ * @return Checksum of the color
+ */
+static uint8_t watchdog_checksum(const color_rgbw_t* color)
+{
+
+    return ~(color->red ^ color->green ^ color->blue ^ color->white);
+
+}
+
+/**
+ * Takes note of the reset cause and stops the watchdog
+ *
+ * After a reset caused by the watchdog, the watchdog stays enabled with its
+ * shortest timeout, so this needs to be called first thing after a reset.
+ */
+void watchdog_init()
+{
+
+    watchdog_reset_flags = MCUSR;
+    MCUSR = 0;
+
+    wdt_disable();
+
+}
+
+/**
+ * Restores the snapshot (if any) and starts the watchdog
+ *
+ * This is expected to be called once all of the other modules have been
+ * initialized and the {@link config_load() configuration} has been loaded.
+ */
+void watchdog_start()
+{
+
+    if ((watchdog_reset_flags & (_BV(WDRF) | _BV(BORF)))
+        && watchdog_snapshot.magic == WATCHDOG_SNAPSHOT_MAGIC
+        && watchdog_snapshot.checksum
+        == watchdog_checksum(&watchdog_snapshot.color)) {
+
+        pwm_set_color_rgbw(&watchdog_snapshot.color);
+
+    }
+
+    watchdog_snapshot.magic = 0;
+
+    watchdog_last_activity = clock_now();
+    watchdog_last_reset = watchdog_last_activity;
+
+    // Save global interrupt flag and disable interrupts
+    uint8_t tmp = SREG;
+    cli();
+
+    wdt_reset();
+
+    // Interrupt and system reset mode, 64 ms
+    hal_watchdog_enable();
+
+    // Restore global interrupt flag
+    SREG = tmp;
+
+}
+
+/**
+ * Resets the watchdog and supervises the bus
+ *
+ * This is expected to be called periodically from within the main loop.
+ */
+void watchdog_update()
+{
+
+    uint16_t now = clock_now();
+
+    // Only reset the watchdog when the clock has advanced
+    if (now == watchdog_last_reset) {
+
+        return;
+
+    }
+
+    watchdog_last_reset = now;
+    wdt_reset();
+
+    if (watchdog_fired) {
+
+        // Save global interrupt flag and disable interrupts
+        uint8_t tmp = SREG;
+        cli();
+
+        watchdog_fired = 0;
+
+        // Enable the interrupt again, which has been cleared by the hardware
+        hal_watchdog_enable();
+
+        // Restore global interrupt flag
+        SREG = tmp;
+
+        if (!watchdog_safe) {
+
+            pwm_enable();
+            cluster_enable();
+
+        }
+
+    }
+
+    if (watchdog_bus_active) {
+
+        watchdog_bus_active = 0;
+        watchdog_last_activity = now;
+
+        if (watchdog_safe) {
+
+            watchdog_safe = 0;
+            pwm_enable();
+            cluster_enable();
+
+        }
+
+    } else if (!watchdog_safe
+        && (uint16_t)(now - watchdog_last_activity) > WATCHDOG_BUS_TIMEOUT) {
+
+        watchdog_safe = 1;
+        pwm_disable();
+        cluster_disable();
+
+    }
+
+}
+
+/**
+ * Takes note that a valid frame has been received
+ *
+ * @note This is expected to be called from within the receive interrupt.
+ */
+void watchdog_bus_activity()
+{
+
+    watchdog_bus_active = 1;
+
+}
+
+/**
+ * Returns the cause of the last reset
+ *
+ * @return Contents of `MCUSR` at the time of the reset
+ */
+uint8_t watchdog_get_reset_flags()
+{
+
+    return watchdog_reset_flags;
+
+}
+
+/**
+ * Takes a snapshot of the state to be restored after a reset
+ *
+ * @note This can be called from within interrupts.
+ *
+ * @see watchdog_snapshot
+ */
+void watchdog_take_snapshot()
+{
+
+    // Save global interrupt flag and disable interrupts
+    uint8_t tmp = SREG;
+    cli();
+
+    pwm_get_color_rgbw(&watchdog_snapshot.color);
+    watchdog_snapshot.checksum = watchdog_checksum(&watchdog_snapshot.color);
+    watchdog_snapshot.magic = WATCHDOG_SNAPSHOT_MAGIC;
+
+    // Restore global interrupt flag
+    SREG = tmp;
+
+}
+
+/**
+ * Enters the safe state before the watchdog resets the microcontroller
+ */
+ISR(WDT_vect)
+{
+
+    watchdog_fired = 1;
+
+    watchdog_take_snapshot();
+
+    pwm_disable();
+    cluster_disable();
+
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2014 Karol Babioch <karol@babioch.de>
+ *
+ * This file is part of LEDTouchTable.
+ *
+ * LEDTouchTable is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LEDTouchTable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LEDTouchTable. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file watchdog.h
+ *
+ * Supervision of the firmware by means of the watchdog
+ *
+ * The watchdog makes sure that a hung pixel doesn't keep its LED lit with
+ * whatever color it had, but enters a defined safe state (outputs disabled)
+ * and reboots quickly. After a reboot the configuration is restored from the
+ * EEPROM and the last color from a snapshot surviving the reset, so that
+ * the pixel rejoins the bus right away.
+ *
+ * Furthermore the pixel enters the safe state when no valid frame has been
+ * received for {@link #WATCHDOG_BUS_TIMEOUT}, so the master is expected to
+ * send frames (e.g. {@link #PROTOCOL_COMMAND_SYNC_CLOCK}) at least that often.
+ *
+ * @see watchdog.c
+ */
+
+#ifndef _LTT_WATCHDOG_H_
+#define _LTT_WATCHDOG_H_
+
+#include <inttypes.h>
+
+#include "clock.h"
+
+/**
+ * @brief Time without valid frames until the safe state is entered (ticks)
+ */
+#define WATCHDOG_BUS_TIMEOUT (3000000UL / CLOCK_TICK)
+
+void watchdog_init();
+void watchdog_start();
+
+void watchdog_update();
+
+void watchdog_bus_activity();
+
+uint8_t watchdog_get_reset_flags();
+void watchdog_take_snapshot();
+
+#endif /* _LTT_WATCHDOG_H_ */